@@ -0,0 +1,201 @@
+#ifndef CIRCULAR_LIST
+#define CIRCULAR_LIST
+
+#include <vector>
+#include <memory>
+
+namespace utils {
+
+//
+// STL-style linked list offering circular iteration
+//
+
+template<typename T>
+class Circular_list {
+    // The ring has no end: begin() is the front and ++/-- wrap around, so
+    // loops are bounded by size(). Links are carved out of slabs owned by the
+    // list and erased links go back on a free list. Once a list has reached
+    // its peak size, inserts and erases never touch the allocator again.
+public:
+    struct Link {
+        T val;
+        Link* prev;
+        Link* succ;
+    };
+
+    class iterator;
+
+    Circular_list() = default;
+    Circular_list(const Circular_list&) = delete;
+    Circular_list& operator=(const Circular_list&) = delete;
+
+    iterator begin() { return iterator{first}; }
+
+    iterator insert(iterator p, const T& v);        // before p
+    iterator erase(iterator p);                     // returns successor
+
+    void push_front(const T& v) { first = insert(begin(), v).data(); }
+    void push_back(const T& v)  { insert(begin(), v); }
+    void pop_front() { erase(begin()); }
+    void pop_back()  { erase(iterator{first->prev}); }
+
+    void rotate(long k);
+    void reserve(size_t n);
+    void clear();
+
+    T& front() { return first->val; }
+    T& back()  { return first->prev->val; }
+
+    size_t size() const { return sz; }
+    bool empty() const { return sz == 0; }
+private:
+    Link* acquire(const T& v);
+    void release(Link* p);
+    void grow(size_t n);
+
+    static constexpr size_t min_slab = 256;
+
+    Link* first = nullptr;
+    Link* free_head = nullptr;              // chained through succ
+    size_t sz = 0;
+    size_t capacity = 0;
+    std::vector<std::unique_ptr<Link[]>> slabs;
+};
+
+template<typename T>
+class Circular_list<T>::iterator {
+public:
+    explicit iterator(Link* p) : curr{p} { }
+
+    iterator& operator++() { curr = curr->succ; return *this; }
+    iterator& operator--() { curr = curr->prev; return *this; }
+
+    T& operator*() { return curr->val; }
+    T* operator->() { return &curr->val; }
+    Link* data() const { return curr; }
+
+    bool operator==(const iterator& b) const { return curr == b.curr; }
+    bool operator!=(const iterator& b) const { return curr != b.curr; }
+private:
+    Link* curr;
+};
+
+template<typename T>
+typename Circular_list<T>::iterator Circular_list<T>::insert(iterator it,
+                                                             const T& val)
+    // Inserting before the front places the value at the back of the ring.
+    // Into an empty list 'it' is ignored.
+{
+    Link* p = acquire(val);
+
+    if (sz == 0) {
+        p->prev = p->succ = p;
+        first = p;
+    } else {
+        Link* s = it.data();
+        p->succ = s;
+        p->prev = s->prev;
+        s->prev->succ = p;
+        s->prev = p;
+    }
+
+    ++sz;
+    return iterator{p};
+}
+
+template<typename T>
+typename Circular_list<T>::iterator Circular_list<T>::erase(iterator it)
+{
+    Link* p = it.data();
+    Link* next = p->succ;
+
+    if (sz == 1) {
+        first = next = nullptr;
+    } else {
+        p->prev->succ = next;
+        next->prev = p->prev;
+        if (p == first)
+            first = next;
+    }
+
+    release(p);
+    --sz;
+    return iterator{next};
+}
+
+template<typename T>
+void Circular_list<T>::rotate(long k)
+    // Moves the front k links forward (negative k moves it backward). Takes
+    // the shorter way around so a rotation costs at most size() / 2 hops.
+{
+    if (sz < 2)
+        return;
+
+    long n = long(sz);
+    k %= n;
+    if (k < 0)
+        k += n;
+    if (k > n / 2)
+        k -= n;
+
+    for (; k > 0; --k)
+        first = first->succ;
+    for (; k < 0; ++k)
+        first = first->prev;
+}
+
+template<typename T>
+void Circular_list<T>::reserve(size_t n)
+{
+    if (capacity < n)
+        grow(n - capacity);
+}
+
+template<typename T>
+void Circular_list<T>::clear()
+    // splice the whole ring onto the free list in one go
+{
+    if (sz == 0)
+        return;
+
+    first->prev->succ = free_head;
+    free_head = first;
+    first = nullptr;
+    sz = 0;
+}
+
+template<typename T>
+typename Circular_list<T>::Link* Circular_list<T>::acquire(const T& val)
+{
+    if (free_head == nullptr)
+        grow(capacity < min_slab ? min_slab : capacity);   // double up
+
+    Link* p = free_head;
+    free_head = p->succ;
+    p->val = val;
+    return p;
+}
+
+template<typename T>
+void Circular_list<T>::release(Link* p)
+{
+    p->succ = free_head;
+    free_head = p;
+}
+
+template<typename T>
+void Circular_list<T>::grow(size_t n)
+{
+    slabs.emplace_back(new Link[n]);
+    Link* slab = slabs.back().get();
+
+    for (size_t i = 0; i < n; ++i) {
+        slab[i].succ = i + 1 < n ? &slab[i + 1] : free_head;
+    }
+    free_head = slab;
+    capacity += n;
+}
+
+}   // utils
+
+#endif  // CIRCULAR_LIST
@@ -0,0 +1,301 @@
+#ifndef ELFCODE
+#define ELFCODE
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <array>
+#include <cstdint>
+#include <algorithm>
+#include <type_traits>
+
+namespace utils {
+
+//
+// The sixteen-opcode device of days 16, 19 and 21
+//
+
+// One row per opcode: mnemonic, kind of operands A and B, and the value
+// written to register C. In the expressions 'r' is the register file, 'a' and
+// 'b' are the operands and 'U' is the unsigned register word, so sums and
+// products wrap instead of overflowing.
+#define ELFCODE_OPS(X)                                                  \
+    X(addr, reg, reg, Word(U(r[a]) + U(r[b])))                          \
+    X(addi, reg, imm, Word(U(r[a]) + U(b)))                             \
+    X(mulr, reg, reg, Word(U(r[a]) * U(r[b])))                          \
+    X(muli, reg, imm, Word(U(r[a]) * U(b)))                             \
+    X(banr, reg, reg, r[a] & r[b])                                      \
+    X(bani, reg, imm, r[a] & b)                                         \
+    X(borr, reg, reg, r[a] | r[b])                                      \
+    X(bori, reg, imm, r[a] | b)                                         \
+    X(setr, reg, any, r[a])                                             \
+    X(seti, imm, any, a)                                                \
+    X(gtir, imm, reg, Word(a > r[b] ? 1 : 0))                           \
+    X(gtri, reg, imm, Word(r[a] > b ? 1 : 0))                           \
+    X(gtrr, reg, reg, Word(r[a] > r[b] ? 1 : 0))                        \
+    X(eqir, imm, reg, Word(a == r[b] ? 1 : 0))                          \
+    X(eqri, reg, imm, Word(r[a] == b ? 1 : 0))                          \
+    X(eqrr, reg, reg, Word(r[a] == r[b] ? 1 : 0))
+
+#define ELFCODE_ENUM(name, ka, kb, expr) name,
+enum Elf_op : std::uint8_t { ELFCODE_OPS(ELFCODE_ENUM) n_elf_ops };
+#undef ELFCODE_ENUM
+
+#define ELFCODE_NAME(name, ka, kb, expr) #name,
+const char* const elf_op_names[n_elf_ops] = { ELFCODE_OPS(ELFCODE_NAME) };
+#undef ELFCODE_NAME
+
+enum Elf_operand : std::uint8_t { any, reg, imm };
+
+#define ELFCODE_KINDS(name, ka, kb, expr) {{ ka, kb }},
+const std::array<Elf_operand,2> elf_operands[n_elf_ops] = {
+    ELFCODE_OPS(ELFCODE_KINDS)
+};
+#undef ELFCODE_KINDS
+
+class Bad_instruction{};    // errors for throwing
+class Bad_program{};
+
+// * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+
+struct Elf_instruction {                    // decoded, 12 bytes
+    std::int32_t a, b;
+    Elf_op op;
+    std::uint8_t c;
+};
+
+struct Elf_program {
+    std::vector<Elf_instruction> code;
+    int ip_reg = -1;                        // -1 when the ip is not bound
+    std::size_t regs_used = 0;              // highest register named + 1
+};
+
+inline Elf_instruction make_instruction(Elf_op op, long long a, long long b,
+                                        long long c)
+    // checks every operand that names a register, and that immediates fit
+{
+    const long long max_reg = 255;
+    auto fits = [max_reg](long long v, Elf_operand kind) {
+        if (kind == reg)
+            return v >= 0 && v <= max_reg;
+        return v >= INT32_MIN && v <= INT32_MAX;
+    };
+
+    if (op >= n_elf_ops || !fits(a, elf_operands[op][0]) ||
+            !fits(b, elf_operands[op][1]) || !fits(c, reg))
+        throw Bad_instruction{};
+
+    return Elf_instruction{std::int32_t(a), std::int32_t(b), op,
+                           std::uint8_t(c)};
+}
+
+inline std::size_t regs_named(const Elf_instruction& ins)
+{
+    std::size_t n = ins.c + 1;
+    if (elf_operands[ins.op][0] == reg)
+        n = std::max<std::size_t>(n, ins.a + 1);
+    if (elf_operands[ins.op][1] == reg)
+        n = std::max<std::size_t>(n, ins.b + 1);
+    return n;
+}
+
+inline void push_instruction(Elf_program& prog, const Elf_instruction& ins)
+{
+    prog.code.push_back(ins);
+    prog.regs_used = std::max(prog.regs_used, regs_named(ins));
+}
+
+inline Elf_op find_op(const std::string& name)
+{
+    for (int op = 0; op < n_elf_ops; ++op)
+        if (name == elf_op_names[op])
+            return Elf_op(op);
+    throw Bad_instruction{};
+}
+
+inline Elf_program parse_program(const std::string& input)
+    // an optional "#ip N" line, then one "name A B C" line per instruction
+{
+    std::istringstream iss {input};
+    Elf_program prog;
+
+    std::string name;
+    while (iss >> name) {
+        if (name == "#ip") {
+            if (!(iss >> prog.ip_reg) || prog.ip_reg < 0 || prog.ip_reg > 255)
+                throw Bad_program{};
+            prog.regs_used = std::max<std::size_t>(prog.regs_used,
+                                                   prog.ip_reg + 1);
+            continue;
+        }
+
+        long long a, b, c;
+        if (!(iss >> a >> b >> c))
+            throw Bad_program{};
+        push_instruction(prog, make_instruction(find_op(name), a, b, c));
+    }
+
+    return prog;
+}
+
+// * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+
+template<typename Word, std::size_t N>
+Word evaluate(Elf_op op, Word a, Word b, const std::array<Word,N>& r)
+    // one op on its own, for callers that test ops rather than run programs;
+    // register operands must already be in range
+{
+    using U = std::make_unsigned_t<Word>;
+
+    switch (op) {
+#define ELFCODE_CASE(name, ka, kb, expr) case name: return (expr);
+    ELFCODE_OPS(ELFCODE_CASE)
+#undef ELFCODE_CASE
+    default:
+        throw Bad_instruction{};
+    }
+}
+
+struct No_hook {
+    template<typename R>
+    bool operator()(R&, std::size_t) const { return true; }
+};
+
+template<typename Word, std::size_t N>
+class Elf_machine {
+    // Runs decoded programs on N registers of type Word. A hook is called
+    // before every instruction with the registers and the ip, and stops the
+    // run by returning false; being a template parameter, No_hook costs
+    // nothing. GCC and Clang dispatch through a table of label addresses
+    // with the fetch repeated at the end of every handler, other compilers
+    // through a switch.
+public:
+    using Registers = std::array<Word,N>;
+
+    Elf_machine() = default;
+
+    Registers& registers() { return regs; }
+    const Registers& registers() const { return regs; }
+    Word& operator[](std::size_t i) { return regs[i]; }
+    Word operator[](std::size_t i) const { return regs[i]; }
+
+    void reset() { regs.fill(0); }
+
+    void run(const Elf_program& prog) { No_hook h; run(prog, h); }
+
+    template<typename Hook>
+    void run(const Elf_program& prog, Hook& hook);
+private:
+    Registers regs {};
+};
+
+template<typename Word, std::size_t N>
+template<typename Hook>
+void Elf_machine<Word,N>::run(const Elf_program& prog, Hook& hook)
+    // Runs from the ip held in the bound register (or from the top when no
+    // register is bound) until the ip leaves the program or the hook says
+    // stop. The registers are worked on in a local copy that nothing else can
+    // alias and stored back at the end. An unbound ip has its own path that
+    // keeps the ip in a pointer and never writes it to a register.
+{
+    using U = std::make_unsigned_t<Word>;
+
+    if (prog.regs_used > N)
+        throw Bad_program{};
+
+    Registers r = regs;
+    const Elf_instruction* const code = prog.code.data();
+    const std::size_t size = prog.code.size();
+    const int ipr = prog.ip_reg;
+    std::size_t ip = ipr >= 0 ? std::size_t(r[ipr]) : 0;
+    const Elf_instruction* pc = code;
+    Word a, b;
+
+#if defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+
+    const Elf_instruction* const end = code + size;
+
+#define ELFCODE_LABEL(name, ka, kb, expr) &&bound_##name,
+    static const void* const bound[n_elf_ops] = { ELFCODE_OPS(ELFCODE_LABEL) };
+#undef ELFCODE_LABEL
+#define ELFCODE_LABEL(name, ka, kb, expr) &&free_##name,
+    static const void* const unbound[n_elf_ops] = {
+        ELFCODE_OPS(ELFCODE_LABEL)
+    };
+#undef ELFCODE_LABEL
+
+#define ELFCODE_BOUND_FETCH                                             \
+    if (ip >= size || !hook(r, ip))                                     \
+        goto halt;                                                      \
+    pc = code + ip;                                                     \
+    a = pc->a;                                                          \
+    b = pc->b;                                                          \
+    goto *bound[pc->op];
+
+#define ELFCODE_FREE_FETCH                                              \
+    if (pc == end || !hook(r, std::size_t(pc - code)))                  \
+        goto halt;                                                      \
+    a = pc->a;                                                          \
+    b = pc->b;                                                          \
+    goto *unbound[pc->op];
+
+#define ELFCODE_HANDLER(name, ka, kb, expr)                             \
+    bound_##name:                                                       \
+        r[pc->c] = (expr);                                              \
+        ip = std::size_t(r[ipr]) + 1;                                   \
+        r[ipr] = Word(ip);                                              \
+        ELFCODE_BOUND_FETCH                                             \
+    free_##name:                                                        \
+        r[pc->c] = (expr);                                              \
+        ++pc;                                                           \
+        ELFCODE_FREE_FETCH
+
+    if (ipr < 0) {
+        ELFCODE_FREE_FETCH
+    }
+    r[ipr] = Word(ip);
+    ELFCODE_BOUND_FETCH
+    ELFCODE_OPS(ELFCODE_HANDLER)
+
+#undef ELFCODE_HANDLER
+#undef ELFCODE_FREE_FETCH
+#undef ELFCODE_BOUND_FETCH
+#pragma GCC diagnostic pop
+
+halt:
+#else
+    if (ipr >= 0)
+        r[ipr] = Word(ip);
+    while (ip < size && hook(r, ip)) {
+        pc = code + ip;
+        a = pc->a;
+        b = pc->b;
+        switch (pc->op) {
+#define ELFCODE_CASE(name, ka, kb, expr)                                \
+        case name:                                                      \
+            r[pc->c] = (expr);                                          \
+            break;
+        ELFCODE_OPS(ELFCODE_CASE)
+#undef ELFCODE_CASE
+        default:
+            throw Bad_instruction{};
+        }
+        if (ipr >= 0) {
+            ip = std::size_t(r[ipr]) + 1;
+            r[ipr] = Word(ip);
+        }
+        else {
+            ++ip;
+        }
+    }
+#endif
+
+    regs = r;
+}
+
+}   // utils
+
+#endif
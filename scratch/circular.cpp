@@ -1,26 +1,46 @@
 #include <iostream>
-#include <list>
+#include <vector>
 #include <algorithm>
 
-#include "circular_list.hpp"
+#include <circular_list.hpp>
+
+uint64_t play_marbles(utils::Circular_list<int>& circle, int num_players,
+                      int marbles)
+{
+    circle.clear();
+    circle.reserve(marbles + 1);
+    circle.push_front(0);
+
+    std::vector<uint64_t> scores (num_players, 0);
+    for (int marble = 1; marble <= marbles; ++marble) {
+        if (marble % 23 == 0) {
+            circle.rotate(-7);
+            scores[marble % num_players] += marble + circle.front();
+            circle.pop_front();
+        } else {
+            circle.rotate(2);
+            circle.push_front(marble);
+        }
+    }
+
+    return *std::max_element(std::begin(scores), std::end(scores));
+}
 
 int main()
 {
     std::cout << "Circular_list test\n";
 
-    std::list<int> li;
-    auto lit = li.begin();
-    li.insert(lit, 42);
-
-    for (auto v : li)
-        std::cout << v << '\n';
+    utils::Circular_list<int> clist;
+    auto it = clist.insert(clist.begin(), 37);
+    clist.insert(it, 42);               // before 37, at the back
+    clist.push_front(7);
 
-    /*
-    Circular_list<int> clist;
-    auto it = clist.begin();
-    clist.insert(it, 37);
+    it = clist.begin();
+    for (size_t i = 0; i < clist.size(); ++i, ++it)
+        std::cout << *it << '\n';       // 7 37 42
 
-    for (auto v : clist)
-        std::cout << v << '\n';
-    */
+    std::cout << "9 players, 25 marbles: "
+              << play_marbles(clist, 9, 25) << '\n';        // 32
+    std::cout << "13 players, 7999 marbles: "
+              << play_marbles(clist, 13, 7999) << '\n';     // 146373
 }
@@ -1,108 +1,176 @@
 #include <iostream>
 #include <vector>
-#include <list>
 #include <numeric>
 
 #include <get_input.hpp>
 
-using Walker = std::vector<int>::const_iterator;
-
 // * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * 
 
-class Node {
+class Tree {
 public:
-    Node(int n_child, int n_metad)
-        : num_child{n_child}, num_metadata{n_metad} { }
+    explicit Tree(const std::vector<int>& input);
 
-    int meta_sum() const;
-    int get_value() const;
+    int get_meta_sum() const;
+    int get_root_val() const { return n_nodes ? get_value(0) : 0; }
+    int get_value(int node) const { return col(value)[node]; }
 
-    void add_child(Node* p) { children.push_back(p); }
-    void add_metadata(int md) { metadata.push_back(md); }
+    int size() const { return n_nodes; }
+    int num_children(int node) const { return col(child_count)[node]; }
+    int child(int node, int i) const
+        { return col(children)[col(child_first)[node] + i]; }
 
 private:
-    int num_child;
-    int num_metadata;
-    std::vector<Node*> children;
-    std::vector<int> metadata;
+    enum Column { child_first, child_count, meta_first, meta_count, value,
+                  children, n_columns };
+
+    int* col(Column c) { return arena.data() + c * max_nodes; }
+    const int* col(Column c) const { return arena.data() + c * max_nodes; }
+    int* metadata() { return col(n_columns); }
+    const int* metadata() const { return col(n_columns); }
+
+    void fill_values();
+
+    int max_nodes;
+    int n_nodes = 0;
+    int n_metadata = 0;
+    std::vector<int> arena;
+    // Nodes are numbered in pre-order and every per-node column, the child
+    // index list and the metadata all live in the one arena allocation. Each
+    // node takes at least two ints of input so input.size() / 2 bounds the
+    // node count up front.
 };
 
-int Node::meta_sum() const
-{
-    return std::accumulate(std::begin(metadata), std::end(metadata), 0);
-}
-
-int Node::get_value() const
+Tree::Tree(const std::vector<int>& input)
+    : max_nodes{int(input.size() / 2)},
+      arena(n_columns * (input.size() / 2) + input.size())
 {
-    if (num_child == 0)
-        return meta_sum();
+    struct Open {
+        int node;
+        int done;
+    };
+    std::vector<Open> open;
+    int n_children = 0;
 
-    int sum = 0;
-    for (const auto md : metadata)
-        if (md <= num_child)
-            sum += children[md-1]->get_value();     // md indexes are 1-based
+    if (input.size() < 2)                   // no header, leave the tree empty
+        return;
 
-    return sum;
+    auto it = std::begin(input);
+    while (std::end(input) - it >= 2) {     // a truncated license just stops
+        int node = n_nodes++;
+        if (!open.empty()) {
+            auto& parent = open.back();
+            col(children)[col(child_first)[parent.node] + parent.done++] = node;
+        }
+
+        col(child_first)[node] = n_children;
+        col(child_count)[node] = *it++;
+        col(meta_count)[node] = *it++;
+        n_children += col(child_count)[node];
+        open.push_back(Open{node, 0});
+
+        while (!open.empty() &&
+                open.back().done == col(child_count)[open.back().node]) {
+            int done = open.back().node;
+            open.pop_back();
+
+            col(meta_first)[done] = n_metadata;
+            for (int i = 0; i < col(meta_count)[done] &&
+                    it != std::end(input); ++i)
+                metadata()[n_metadata++] = *it++;
+        }
+
+        if (open.empty())
+            break;
+    }
+
+    fill_values();
 }
 
-// * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * 
-
-Node* create_node(Walker& it, std::list<Node>& owner)
-    // The iterator is never checked against end of sequence because the input
-    // data will cancel itself.
+void Tree::fill_values()
+    // Pre-order numbering puts every child after its parent so walking the
+    // nodes backwards fills the value column bottom-up. Each value is
+    // computed once no matter how often the metadata refers to it.
 {
-    auto n_child = *it++;
-    auto n_metad = *it++;
-
-    owner.emplace_back(Node{n_child, n_metad});
-    auto p_node = &owner.back();
-
-    for (int i = 0; i < n_child; ++i)
-        p_node->add_child(create_node(it, owner));      // recurse
-
-    for (int i = 0; i < n_metad; ++i)
-        p_node->add_metadata(*it++);
+    for (int node = n_nodes - 1; node >= 0; --node) {
+        auto first = metadata() + col(meta_first)[node];
+        auto last = first + col(meta_count)[node];
+        int n_child = col(child_count)[node];
+
+        if (n_child == 0) {
+            col(value)[node] = std::accumulate(first, last, 0);
+            continue;
+        }
+
+        int sum = 0;
+        for (auto md = first; md != last; ++md)
+            if (0 < *md && *md <= n_child)
+                sum += col(value)[child(node, *md - 1)];  // md is 1-based
+        col(value)[node] = sum;
+    }
+}
 
-    return p_node;
+int Tree::get_meta_sum() const
+{
+    return std::accumulate(metadata(), metadata() + n_metadata, 0);
 }
 
 // * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * 
 
-class Tree {
-public:
-    explicit Tree(const std::vector<int>& input);
-
-    int get_meta_sum() const;
-    int get_root_val() const;
-
-private:
-    Node* root;
-    std::list<Node> owner;
-    // Changed 'owner' to a std::list after a bunch of sneaky errors ended up
-    // being caused by vector reallocations. Rather than tag each of the
-    // children with a parent tag to call back to on a move I went with the
-    // list.
-    // Sneaky Errors: Seg-fault on large input set, incorrect metadata sums and
-    // missing children on the smaller test input.
+struct License_summary {
+    int meta_sum = 0;
+    int root_val = 0;
 };
 
-Tree::Tree(const std::vector<int>& input)
+template<typename Iter>
+License_summary stream_license(Iter first, Iter last)
+    // Single pass over the license without building a tree. Each open node
+    // keeps a frame on an explicit stack and finished child values wait on a
+    // shared value stack until the parent reads its metadata, so memory only
+    // grows with the depth (and fan-out) of the current path.
 {
-    auto it = std::begin(input);
-    root = create_node(it, owner);
-}
-
-int Tree::get_meta_sum() const
-{
-    return std::accumulate(std::begin(owner), std::end(owner), 0,
-            [](auto& sum, const auto& n) {
-                return sum + n.meta_sum();
-            });
-}
-
-int Tree::get_root_val() const
-{
-    return root->get_value();
+    struct Frame {
+        int n_child;
+        int n_metad;
+        int done;                   // children fully read
+        size_t vals_base;           // first child value on the value stack
+    };
+
+    License_summary summary;
+    std::vector<Frame> frames;
+    std::vector<int> vals;
+
+    while (first != last) {
+        int n_child = *first++;
+        if (first == last)
+            break;                  // truncated, stop where the input does
+        int n_metad = *first++;
+        frames.push_back(Frame{n_child, n_metad, 0, vals.size()});
+
+        while (!frames.empty() && frames.back().done == frames.back().n_child) {
+            const auto fr = frames.back();
+            frames.pop_back();
+
+            int value = 0;
+            for (int i = 0; i < fr.n_metad && first != last; ++i) {
+                int md = *first++;
+                summary.meta_sum += md;
+                if (fr.n_child == 0)
+                    value += md;
+                else if (0 < md && md <= fr.n_child)
+                    value += vals[fr.vals_base + md - 1];   // 1-based
+            }
+            vals.resize(fr.vals_base);
+
+            if (frames.empty()) {
+                summary.root_val = value;
+                return summary;
+            }
+            vals.push_back(value);
+            ++frames.back().done;
+        }
+    }
+
+    return summary;
 }
 
 // * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * 
@@ -112,10 +180,14 @@ int main(int argc, char* argv[])
     std::cout << "AoC 2018 Day 8 - Memory Maneuver\n";
 
     auto input = utils::get_input_values<int>(argc, argv, "08");
-    auto tree = Tree{input};
+    auto summary = stream_license(std::begin(input), std::end(input));
+    Tree tree {input};
 
-    auto part1 = tree.get_meta_sum();
+    auto part1 = summary.meta_sum;
     std::cout << "Part 1: " << part1 << '\n';
     auto part2 = tree.get_root_val();
     std::cout << "Part 2: " << part2 << '\n';
+
+    if (tree.get_meta_sum() != part1 || summary.root_val != part2)
+        std::cerr << "Error: tree and streamed totals differ\n";
 }
@@ -1,42 +1,79 @@
 #include <iostream>
 #include <string>
-#include <list>
 #include <vector>
 #include <algorithm>
 #include <regex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
 
 #include <get_input.hpp>
 
-template<typename Iter>
-void circular_inc(Iter first, Iter last, int inc, Iter& it)
+class Marble_ring {
+public:
+    explicit Marble_ring(int marbles) { reset(marbles); }
+
+    void reset(int marbles);
+
+    int current() const { return curr; }
+    void place(int marble);
+    int remove_ccw(int steps);
+private:
+    std::vector<uint32_t> next;
+    std::vector<uint32_t> prev;
+    uint32_t curr = 0;
+    // Every marble is placed at most once so the links are indexed by the
+    // marble's value. Both arrays are sized once for the whole game and the
+    // hot loop never allocates.
+};
+
+void Marble_ring::reset(int marbles)
 {
-    while (inc--) {
-        if (it == last)
-            it = first;
-        ++it;
-    }
+    next.assign(marbles + 1, 0);
+    prev.assign(marbles + 1, 0);
+    curr = 0;
 }
 
-template<typename Iter>
-void circular_dec(Iter first, Iter last, int dec, Iter& it)
+void Marble_ring::place(int marble)
+    // between the marbles 1 and 2 steps clockwise, becomes the current marble
 {
-    while (dec++) {
-        if (it == first)
-            it = last;
-        --it;
-    }
+    uint32_t left = next[curr];
+    uint32_t right = next[left];
+
+    next[left] = marble;
+    prev[marble] = left;
+    next[marble] = right;
+    prev[right] = marble;
+    curr = marble;
+}
+
+int Marble_ring::remove_ccw(int steps)
+    // the marble clockwise of the removed one becomes the current marble
+{
+    uint32_t m = curr;
+    while (steps--)
+        m = prev[m];
+
+    next[prev[m]] = next[m];
+    prev[next[m]] = prev[m];
+    curr = next[m];
+    return m;
 }
 
 // * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * 
 
 struct Game_params {
     explicit Game_params(const std::string& desc);
-    int players, marbles;
+    int players = 0, marbles = 0;
 };
 
 Game_params::Game_params(const std::string& description)
 {
-    static const std::regex pat {R"(^(\d+).*\s(\d+)\spoints$)"};
+    static const std::regex pat {R"(^(\d+).*\s(\d+)\spoints\s*$)"};
     std::smatch matches;
     if (std::regex_match(description, matches, pat)) {
         players = std::stoi(matches[1]);
@@ -48,42 +85,122 @@ Game_params::Game_params(const std::string& description)
 
 // * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * 
 
-uint64_t play_marbles(int num_players, int marbles)
+uint64_t play_marbles(int num_players, int marbles, Marble_ring& ring)
 {
-    int marble = 0;
-    std::list<int> circle {marble};
+    ring.reset(marbles);
     std::vector<uint64_t> scores (num_players, 0);
-    size_t player_i = 0;
-
-    auto it = std::begin(circle);
-    while (marble < marbles) {
-        ++marble;
-
-        if (marble % 23 == 0) {
-            circular_dec(std::begin(circle), std::end(circle), -7, it);
-            scores[player_i] += marble + *it;
-            it = circle.erase(it);
-        } else {
-            circular_inc(std::begin(circle), std::end(circle), 2, it);
-            it = circle.insert(it, marble);
-        }
-
-        ++player_i;
-        player_i %= num_players;
+    int player_i = 0;
+
+    for (int marble = 1; marble <= marbles; ++marble) {
+        if (marble % 23 == 0)
+            scores[player_i] += marble + ring.remove_ccw(7);
+        else
+            ring.place(marble);
+
+        if (++player_i == num_players)
+            player_i = 0;
     }
 
     return *std::max_element(std::begin(scores), std::end(scores));
 }
 
+uint64_t play_marbles(int num_players, int marbles)
+{
+    Marble_ring ring {marbles};
+    return play_marbles(num_players, marbles, ring);
+}
+
+// * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * 
+
+std::vector<uint64_t> play_batch(const std::vector<Game_params>& games)
+    // Games are handed out one at a time from a shared counter. Each thread
+    // keeps its own ring, which only grows when it meets a bigger game.
+{
+    std::vector<uint64_t> scores (games.size(), 0);
+    std::atomic<size_t> next_game {0};
+
+    auto worker = [&games, &scores, &next_game]() {
+        Marble_ring ring {0};
+        for (size_t i; (i = next_game++) < games.size(); )
+            scores[i] = play_marbles(games[i].players, games[i].marbles, ring);
+    };
+
+    size_t num_threads = std::thread::hardware_concurrency();
+    num_threads = std::max<size_t>(1, std::min(num_threads, games.size()));
+
+    std::vector<std::thread> vt;
+    for (size_t i = 0; i < num_threads; ++i)
+        vt.emplace_back(worker);
+    for (auto& t : vt)
+        t.join();
+
+    return scores;
+}
+
+long peak_memory_kib()
+    // -1 where the platform gives us no way to ask
+{
+#if defined(__unix__) || defined(__APPLE__)
+    rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) != 0)
+        return -1;
+#if defined(__APPLE__)
+    return ru.ru_maxrss / 1024;             // bytes on macOS
+#else
+    return ru.ru_maxrss;
+#endif
+#else
+    return -1;
+#endif
+}
+
+void run_batch(const std::vector<std::string>& lines)
+{
+    std::vector<Game_params> games;
+    for (const auto& line : lines)
+        if (line.find_first_not_of(" \t\r") != std::string::npos)
+            games.emplace_back(Game_params{line});
+
+    games.erase(std::remove_if(std::begin(games), std::end(games),
+                [](const auto& gp) { return gp.players <= 0; }),
+            std::end(games));
+
+    auto start = std::chrono::steady_clock::now();
+    auto scores = play_batch(games);
+    std::chrono::duration<double> secs = std::chrono::steady_clock::now()
+                                         - start;
+
+    for (size_t i = 0; i < games.size(); ++i)
+        std::cout << games[i].players << " players; " << games[i].marbles
+                  << " marbles: " << scores[i] << '\n';
+
+    std::cout << "Games: " << games.size() << " in " << secs.count() << "s ("
+              << (secs.count() > 0 ? games.size() / secs.count() : 0)
+              << " games/s)\n";
+
+    auto peak = peak_memory_kib();
+    if (peak >= 0)
+        std::cout << "Peak memory: " << peak << " KiB\n";
+}
+
 // * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * 
 
 int main(int argc, char* argv[])
 {
     std::cout << "AoC 2018 Day 9 - Marble Mania\n";
 
+    // batch mode: day09 -b [-t | file] plays every game line in the file
+    if (argc > 1 && std::string{argv[1]} == "-b") {
+        auto lines = utils::get_input_lines(argc - 1, argv + 1, "09");
+        run_batch(lines);
+        return 0;
+    }
+
     auto input = utils::get_input_string(argc, argv, "09");
 
     auto gp = Game_params{input};
+    if (gp.players <= 0)                    // nothing parsed, nothing to play
+        return 1;
 
     auto part1 = play_marbles(gp.players, gp.marbles);
     std::cout << "Part 1: " << part1 << '\n';
@@ -3,18 +3,93 @@
 #include <vector>
 #include <regex>
 #include <fstream>
+#include <cmath>
+#include <limits>
 
 #include <get_input.hpp>
 
-struct Light {
-    void advance() { x += dx; y += dy; }
-    void rewind()  { x -= dx; y -= dy; }
-    int x, y, dx, dy;
+// * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * 
+
+struct Min_max {
+    Min_max(int x0, int y0, int x1, int y1)
+        : min_x{x0}, min_y{y0}, max_x{x1}, max_y{y1} { }
+
+    int get_width()  const { return max_x - min_x; }
+    int get_height() const { return max_y - min_y; }
+
+    int min_x, min_y, max_x, max_y;
+};
+
+bool operator<(const Min_max& a, const Min_max& b)
+{
+    return a.get_height() < b.get_height();
+}
+
+// * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * 
+
+class Light_field {
+public:
+    void add(int x, int y, int dx, int dy);
+
+    size_t size() const { return xs.size(); }
+    int x(size_t i) const { return xs[i]; }
+    int y(size_t i) const { return ys[i]; }
+    int dy(size_t i) const { return dys[i]; }
+
+    Min_max advance(int k);
+    Min_max bounds() const;
+private:
+    std::vector<int> xs, ys, dxs, dys;
+    // Struct-of-arrays so the advance and the bounding box can share one
+    // pass of straight loads that the compiler vectorizes.
 };
 
+void Light_field::add(int x, int y, int dx, int dy)
+{
+    xs.push_back(x);
+    ys.push_back(y);
+    dxs.push_back(dx);
+    dys.push_back(dy);
+}
+
+Min_max Light_field::advance(int k)
+    // moves every light k seconds (k may be negative) and measures the sky
+{
+    int min_x = std::numeric_limits<int>::max();
+    int min_y = std::numeric_limits<int>::max();
+    int max_x = std::numeric_limits<int>::min();
+    int max_y = std::numeric_limits<int>::min();
+
+    int* px = xs.data();
+    int* py = ys.data();
+    const int* pdx = dxs.data();
+    const int* pdy = dys.data();
+    const size_t n = size();
+
+    for (size_t i = 0; i < n; ++i) {
+        int nx = px[i] + k * pdx[i];
+        int ny = py[i] + k * pdy[i];
+        px[i] = nx;
+        py[i] = ny;
+        min_x = std::min(min_x, nx);
+        max_x = std::max(max_x, nx);
+        min_y = std::min(min_y, ny);
+        max_y = std::max(max_y, ny);
+    }
+
+    return Min_max{min_x, min_y, max_x, max_y};
+}
+
+Min_max Light_field::bounds() const
+{
+    auto mmx = std::minmax_element(std::begin(xs), std::end(xs));
+    auto mmy = std::minmax_element(std::begin(ys), std::end(ys));
+    return Min_max{*mmx.first, *mmy.first, *mmx.second, *mmy.second};
+}
+
 auto parse_light_input(const std::vector<std::string>& input)
 {
-    std::vector<Light> vlights;
+    Light_field lights;
 
     static const std::regex pat {
         R"(^position=<\s?(-?\d+),\s+(-?\d+).*<\s?(-?\d+),\s+(-?\d+)>$)"
@@ -30,80 +105,154 @@ auto parse_light_input(const std::vector<std::string>& input)
             y  = std::stoi(*it++);
             dx = std::stoi(*it++);
             dy = std::stoi(*it++);
-            vlights.emplace_back(Light{x, y, dx, dy});
+            lights.add(x, y, dx, dy);
         } else {
             std::cout << "Problem: No match! Check your foolish regex..\n";
         }
     }
 
-    return vlights;
+    return lights;
 }
 
 // * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * 
 
-struct Min_max {
-    explicit Min_max(const std::vector<Light>& vlights);
+struct Glyph {
+    char ch;
+    const char* rows[10];
+};
 
-    int get_width()  const { return max_x - min_x; }
-    int get_height() const { return max_y - min_y; }
+const int glyph_w = 6;
+const int glyph_h = 10;
 
-    int min_x, min_y, max_x, max_y;
+const Glyph sky_font[] = {
+    {'A', {"..##..", ".#..#.", "#....#", "#....#", "#....#",
+           "######", "#....#", "#....#", "#....#", "#....#"}},
+    {'B', {"#####.", "#....#", "#....#", "#....#", "#####.",
+           "#....#", "#....#", "#....#", "#....#", "#####."}},
+    {'C', {".####.", "#....#", "#.....", "#.....", "#.....",
+           "#.....", "#.....", "#.....", "#....#", ".####."}},
+    {'E', {"######", "#.....", "#.....", "#.....", "#####.",
+           "#.....", "#.....", "#.....", "#.....", "######"}},
+    {'F', {"######", "#.....", "#.....", "#.....", "#####.",
+           "#.....", "#.....", "#.....", "#.....", "#....."}},
+    {'G', {".####.", "#....#", "#.....", "#.....", "#.....",
+           "#..###", "#....#", "#....#", "#...##", ".###.#"}},
+    {'H', {"#....#", "#....#", "#....#", "#....#", "######",
+           "#....#", "#....#", "#....#", "#....#", "#....#"}},
+    {'J', {"...###", "....#.", "....#.", "....#.", "....#.",
+           "....#.", "....#.", "#...#.", "#...#.", ".###.."}},
+    {'K', {"#....#", "#...#.", "#..#..", "#.#...", "##....",
+           "##....", "#.#...", "#..#..", "#...#.", "#....#"}},
+    {'L', {"#.....", "#.....", "#.....", "#.....", "#.....",
+           "#.....", "#.....", "#.....", "#.....", "######"}},
+    {'N', {"#....#", "##...#", "##...#", "#.#..#", "#.#..#",
+           "#..#.#", "#..#.#", "#...##", "#...##", "#....#"}},
+    {'P', {"#####.", "#....#", "#....#", "#....#", "#####.",
+           "#.....", "#.....", "#.....", "#.....", "#....."}},
+    {'R', {"#####.", "#....#", "#....#", "#....#", "#####.",
+           "#..#..", "#...#.", "#...#.", "#....#", "#....#"}},
+    {'X', {"#....#", "#....#", ".#..#.", ".#..#.", "..##..",
+           "..##..", ".#..#.", ".#..#.", "#....#", "#....#"}},
+    {'Z', {"######", ".....#", ".....#", "....#.", "...#..",
+           "..#...", ".#....", "#.....", "#.....", "######"}},
 };
 
-Min_max::Min_max(const std::vector<Light>& vlights)
+uint64_t glyph_key(const Glyph& g)
 {
-    min_x = std::min_element(std::begin(vlights), std::end(vlights),
-            [](const Light& a, const Light& b) { return a.x < b.x; })->x;
-    min_y = std::min_element(std::begin(vlights), std::end(vlights),
-            [](const Light& a, const Light& b) { return a.y < b.y; })->y;
-    max_x = std::max_element(std::begin(vlights), std::end(vlights),
-            [](const Light& a, const Light& b) { return a.x < b.x; })->x;
-    max_y = std::max_element(std::begin(vlights), std::end(vlights),
-            [](const Light& a, const Light& b) { return a.y < b.y; })->y;
-}
-
-bool operator<(const Min_max& a, const Min_max& b)
-{
-    return a.get_height() < b.get_height();
+    uint64_t key = 0;
+    for (int r = 0; r < glyph_h; ++r)
+        for (int c = 0; c < glyph_w; ++c)
+            if (g.rows[r][c] == '#')
+                key |= uint64_t{1} << (r * glyph_w + c);
+    return key;
 }
 
 // * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * 
 
 class Grid {
 public:
-    Grid(const std::vector<Light>& vlights);
+    Grid(const Light_field& lights);
 
     void print_sky() const;
+    std::string read_message() const;
 private:
+    bool lit(int x, int y) const
+        { return (bits[y * row_words + x / 64] >> (x % 64)) & 1; }
+    bool column_empty(int x) const;
 
     int shift_x(int x) const { return x - mm.min_x; }
     int shift_y(int y) const { return y - mm.min_y; }
 
     Min_max mm;
-    std::vector<std::vector<char>> grid;
+    int width, height;
+    int row_words;
+    std::vector<uint64_t> bits;             // one bit per point, row major
 };
 
-Grid::Grid(const std::vector<Light>& vlights)
-    : mm{vlights}
+Grid::Grid(const Light_field& lights)
+    : mm{lights.bounds()},
+      width{mm.get_width() + 1}, height{mm.get_height() + 1},
+      row_words{(width + 63) / 64},
+      bits(size_t(row_words) * height, 0)
 {
-    grid.resize(mm.max_y + 1 - mm.min_y);
-    for (auto& vc : grid) {
-        vc.resize(mm.max_x + 1 - mm.min_x);
-        std::fill(std::begin(vc), std::end(vc), '.');
+    for (size_t i = 0; i < lights.size(); ++i) {
+        int x = shift_x(lights.x(i));
+        bits[shift_y(lights.y(i)) * row_words + x / 64]
+            |= uint64_t{1} << (x % 64);
     }
+}
 
-    for (const auto& l : vlights) {
-        grid[shift_y(l.y)][shift_x(l.x)] = '#';
+void Grid::print_sky() const
+    // render into one buffer and hand it over in a single write
+{
+    std::string sky (size_t(width + 1) * height, '.');
+
+    auto out = std::begin(sky);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x, ++out)
+            if (lit(x, y))
+                *out = '#';
+        *out++ = '\n';
     }
+
+    std::cout.write(sky.data(), sky.size());
 }
 
-void Grid::print_sky() const
+bool Grid::column_empty(int x) const
 {
-    for (const auto& vl : grid) {
-        for (const auto l : vl)
-            std::cout << l;
-        std::cout << '\n';
+    for (int y = 0; y < height; ++y)
+        if (lit(x, y))
+            return false;
+    return true;
+}
+
+std::string Grid::read_message() const
+    // Letters are 6x10 and separated by blank columns. Anything not in the
+    // font reads as '?'; a sky of the wrong height reads as nothing at all.
+{
+    std::string message;
+    if (height != glyph_h)
+        return message;
+
+    for (int x = 0; x < width; ) {
+        if (column_empty(x)) {
+            ++x;
+            continue;
+        }
+
+        uint64_t key = 0;
+        for (int r = 0; r < glyph_h; ++r)
+            for (int c = 0; c < glyph_w && x + c < width; ++c)
+                if (lit(x + c, r))
+                    key |= uint64_t{1} << (r * glyph_w + c);
+
+        auto it = std::find_if(std::begin(sky_font), std::end(sky_font),
+                [key](const auto& g) { return glyph_key(g) == key; });
+        message += it != std::end(sky_font) ? it->ch : '?';
+        x += glyph_w;
     }
+
+    return message;
 }
 
 // * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * 
@@ -111,45 +260,90 @@ void Grid::print_sky() const
 class Star_field {
 public:
     Star_field(const std::vector<std::string>& input)
-        : vlights{parse_light_input(input)}, mm{vlights} { }
+        : lights{parse_light_input(input)}, mm{lights.bounds()} { }
 
-    const std::vector<Light>& get_vlights() const { return vlights; }
+    const Light_field& get_lights() const { return lights; }
 
     int time_to_shortest();
 private:
-    void advance_all();
-    void rewind_all();
+    int estimate_convergence() const;
+    int height_at(int t) { return jump_to(t).get_height(); }
+    const Min_max& jump_to(int t);
 
-    std::vector<Light> vlights;
+    Light_field lights;
     Min_max mm;
+    int now = 0;
 };
 
 int Star_field::time_to_shortest()
+    // Bounding-box height is the max of some lines minus the min of others,
+    // which makes it convex in time. Starting from the least squares guess,
+    // widen a bracket until the height rises on both sides and then ternary
+    // search it. Every probe is one fused jump of the whole field.
 {
-    int old_height, time_s = 0;
-    do {
-        old_height = mm.get_height();
-        advance_all();
-        ++time_s;
-    } while (old_height > mm.get_height());
-    rewind_all();
-    --time_s;
-    
+    int guess = estimate_convergence();
+    int lo = guess, hi = guess;
+
+    for (int w = 1; ; w *= 2) {
+        lo = std::max(0, guess - w);
+        hi = guess + w;
+        bool left_ok  = lo == 0 || height_at(lo - 1) > height_at(lo);
+        bool right_ok = height_at(hi + 1) >= height_at(hi);
+        if (left_ok && right_ok)
+            break;
+    }
+
+    while (hi - lo > 2) {
+        int m1 = lo + (hi - lo) / 3;
+        int m2 = hi - (hi - lo) / 3;
+        if (height_at(m1) <= height_at(m2))
+            hi = m2;
+        else
+            lo = m1 + 1;
+    }
+
+    int time_s = lo;
+    for (int t = lo + 1; t <= hi; ++t)
+        if (height_at(t) < height_at(time_s))
+            time_s = t;
+
+    jump_to(time_s);
     return time_s;
 }
 
-void Star_field::advance_all()
+int Star_field::estimate_convergence() const
+    // Least squares on y(t) = y0 + dy * t: the spread of the y's is smallest
+    // at t = -cov(y0, dy) / var(dy).
 {
-    for (auto& l : vlights)
-        l.advance();
-    mm = Min_max{vlights};
+    auto y0 = [this](size_t i) {
+        return lights.y(i) - double(now) * lights.dy(i);
+    };
+
+    double n = lights.size();
+    double sum_y = 0, sum_dy = 0;
+    for (size_t i = 0; i < lights.size(); ++i) {
+        sum_y += y0(i);
+        sum_dy += lights.dy(i);
+    }
+
+    double cov = 0, var = 0;
+    for (size_t i = 0; i < lights.size(); ++i) {
+        double ey = y0(i) - sum_y / n;
+        double edy = lights.dy(i) - sum_dy / n;
+        cov += ey * edy;
+        var += edy * edy;
+    }
+
+    if (var == 0)
+        return 0;
+    return std::max(0, int(std::lround(-cov / var)));
 }
 
-void Star_field::rewind_all()
+const Min_max& Star_field::jump_to(int t)
 {
-    for (auto& l : vlights)
-        l.rewind();
-    mm = Min_max{vlights};
+    mm = lights.advance(t - now);
+    now = t;
+    return mm;
 }
 
 // * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * 
@@ -161,7 +355,11 @@ int main(int argc, char* argv[])
     auto input = utils::get_input_lines(argc, argv, "10");
     Star_field sf {input};
     auto time_s = sf.time_to_shortest();
-    Grid sky {sf.get_vlights()};
+    Grid sky {sf.get_lights()};
     sky.print_sky();
+
+    auto message = sky.read_message();
+    if (!message.empty())
+        std::cout << "Message: " << message << '\n';
     std::cout << "Time till message: " << time_s << '\n';
 }
@@ -3,6 +3,9 @@
 #include <algorithm>
 #include <regex>
 #include <sstream>
+#include <array>
+#include <cstdint>
+#include <unordered_map>
 
 #include <get_input.hpp>
 
@@ -27,93 +30,433 @@ Growth_condition::Growth_condition(const std::string& s)
     result = r == '#' ? true : false;
 }
 
+using Rule_table = std::array<bool,32>;
+
+Rule_table make_rule_table(const std::vector<Growth_condition>& vcond)
+    // bit k of the index is the pot k - 2 places from the centre
+{
+    Rule_table rules {};
+    for (const auto& cnd : vcond) {
+        int index = 0;
+        for (int k = 0; k < 5; ++k)
+            if (cnd.pattern[k] == '#')
+                index |= 1 << k;
+        rules[index] = cnd.result;
+    }
+    return rules;
+}
+
+// * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * 
+
+int lowest_bit(uint64_t w)
+{
+#if defined(__GNUC__)
+    return __builtin_ctzll(w);
+#else
+    int i = 0;
+    for (; !(w & 1); w >>= 1)
+        ++i;
+    return i;
+#endif
+}
+
+// * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * 
+
+class Hash_life {
+public:
+    Hash_life(const std::string& state,
+              const std::vector<Growth_condition>& vcond, int64_t first_pot = 0);
+
+    void advance_year(int64_t n);
+    int64_t sum_plant_pots() const;
+    size_t size() const { return nodes.size(); }
+private:
+    struct Node {
+        int left, right;
+        int level;                      // covers 2^level pots
+        uint64_t count;                 // plants
+        uint64_t pos_sum;               // plant positions relative to pot 0
+    };
+
+    int join(int left, int right);
+    int empty(int level);
+    int centre(int id);
+    int step(int id, int j);
+    int leaf_pair(int id) const         // the 16 pots of a level 4 block
+        { return nodes[id].left | nodes[id].right << 8; }
+    bool is_empty(int id) const { return nodes[id].count == 0; }
+    void expand();
+
+    Rule_table rules;
+    std::vector<Node> nodes;
+    std::vector<int> empties;
+    std::unordered_map<uint64_t,int> joined;
+    std::unordered_map<uint64_t,int> stepped;
+    int root;
+    uint64_t origin;                    // pot number of the root's pot 0
+    // One dimensional HashLife. The 256 blocks of 8 pots are the leaves and
+    // every larger block is a canonical pair of halves, so identical blocks
+    // anywhere in space or time share one node. step(id, j) is the centre
+    // half of a block 2^j generations on and is memoized per node, which
+    // lets a single call jump 2^j generations at once. Positions and sums
+    // use wrapping unsigned arithmetic and are exact whenever the answer
+    // fits in 64 bits.
+};
+
+Hash_life::Hash_life(const std::string& state,
+                     const std::vector<Growth_condition>& vcond,
+                     int64_t first_pot)
+    : rules{make_rule_table(vcond)}, origin(first_pot)
+{
+    for (int i = 0; i < 256; ++i) {             // leaves hold their own bits
+        Node leaf {i, -1, 3, 0, 0};
+        for (int b = 0; b < 8; ++b)
+            if (i & (1 << b)) {
+                ++leaf.count;
+                leaf.pos_sum += b;
+            }
+        nodes.push_back(leaf);
+    }
+
+    std::vector<int> level;
+    for (size_t i = 0; i < state.size(); i += 8) {
+        int bits = 0;
+        for (size_t b = 0; b < 8 && i + b < state.size(); ++b)
+            if (state[i + b] == '#')
+                bits |= 1 << b;
+        level.push_back(bits);
+    }
+
+    while (level.size() < 2 || (level.size() & (level.size() - 1)))
+        level.push_back(0);                     // power of two, level 4 up
+    while (level.size() > 1) {
+        std::vector<int> up;
+        for (size_t i = 0; i < level.size(); i += 2)
+            up.push_back(join(level[i], level[i + 1]));
+        level.swap(up);
+    }
+    root = level.front();
+}
+
+int Hash_life::join(int left, int right)
+{
+    uint64_t key = uint64_t(uint32_t(left)) << 32 | uint32_t(right);
+    auto it = joined.find(key);
+    if (it != std::end(joined))
+        return it->second;
+
+    const auto& l = nodes[left];
+    const auto& r = nodes[right];
+    uint64_t half = uint64_t{1} << l.level;
+    nodes.push_back(Node{left, right, l.level + 1, l.count + r.count,
+                         l.pos_sum + r.pos_sum + r.count * half});
+    joined.emplace(key, int(nodes.size() - 1));
+    return int(nodes.size() - 1);
+}
+
+int Hash_life::empty(int level)
+{
+    if (empties.empty())
+        empties.push_back(0);                   // level 3 leaf
+    while (int(empties.size()) <= level - 3)
+        empties.push_back(join(empties.back(), empties.back()));
+    return empties[level - 3];
+}
+
+int Hash_life::centre(int id)
+{
+    const auto& n = nodes[id];
+    if (n.level == 4)
+        return (leaf_pair(id) >> 4) & 0xff;
+    return join(nodes[n.left].right, nodes[n.right].left);
+}
+
+int Hash_life::step(int id, int j)
+    // The centre half of a level k block after 2^j generations, j <= k - 3:
+    // pots spread at most 2 a generation, so that centre only depends on
+    // pots inside the block.
+{
+    if (is_empty(id))
+        return empty(nodes[id].level - 1);
+
+    uint64_t key = uint64_t(id) << 6 | uint64_t(j);
+    auto it = stepped.find(key);
+    if (it != std::end(stepped))
+        return it->second;
+
+    int result;
+    const int k = nodes[id].level;
+    if (k == 4) {                               // 16 pots, run it by hand
+        int bits = leaf_pair(id);
+        for (int g = 0; g < (1 << j); ++g) {
+            int next = 0;
+            for (int i = 2; i < 14; ++i)
+                if (rules[(bits >> (i - 2)) & 31])
+                    next |= 1 << i;
+            bits = next;
+        }
+        result = (bits >> 4) & 0xff;
+    } else {
+        int a = nodes[id].left;
+        int b = nodes[id].right;
+        int m = join(nodes[a].right, nodes[b].left);
+
+        int ra, rm, rb;
+        if (j == k - 3) {                       // first half of the jump..
+            ra = step(a, j - 1);
+            rm = step(m, j - 1);
+            rb = step(b, j - 1);
+        } else {                                // ..or none of it
+            ra = centre(a);
+            rm = centre(m);
+            rb = centre(b);
+        }
+
+        int jj = j == k - 3 ? j - 1 : j;
+        int x = step(join(ra, rm), jj);
+        int y = step(join(rm, rb), jj);
+        result = join(x, y);
+    }
+
+    stepped.emplace(key, result);
+    return result;
+}
+
+void Hash_life::expand()
+    // same pots, twice the room, current block in the centre half
+{
+    int e = empty(nodes[root].level - 1);
+    int left = nodes[root].left;
+    int right = nodes[root].right;
+    origin -= uint64_t{1} << (nodes[root].level - 1);
+    root = join(join(e, left), join(right, e));
+}
+
+void Hash_life::advance_year(int64_t n)
+{
+    for (int j = 0; n > 0; ++j, n >>= 1) {
+        if ((n & 1) == 0)
+            continue;
+
+        // Stepping drops the outer quarters, so keep the plants inside the
+        // middle quarter with at least 2^(j+1) pots of clearance around it.
+        auto crowded = [this]() {
+            const auto& r = nodes[root];
+            const auto& a = nodes[r.left];
+            const auto& b = nodes[r.right];
+            return !is_empty(a.left) || !is_empty(b.right) ||
+                   !is_empty(nodes[a.right].left) ||
+                   !is_empty(nodes[b.left].right);
+        };
+        while (nodes[root].level < j + 4 || nodes[root].level < 6 ||
+                crowded())
+            expand();
+
+        origin += uint64_t{1} << (nodes[root].level - 2);
+        root = step(root, j);
+    }
+}
+
+int64_t Hash_life::sum_plant_pots() const
+{
+    const auto& r = nodes[root];
+    return int64_t(r.pos_sum + r.count * origin);
+}
+
 // * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * 
 
 class Plant_plan {
 public:
-    Plant_plan(std::string init, std::vector<Growth_condition> vcond)
-        : state{std::move(init)}, conditions{std::move(vcond)} { }
+    Plant_plan(std::string init, std::vector<Growth_condition> vcond);
 
     int64_t sum_plant_pots() const;
-    const std::string& get_state() const { return state; }
+    std::string get_state() const;
 
     int64_t advance_year(int64_t n);
 private:
     void prep_state();
     void advance_year();
+    std::string normalized(int64_t& offset) const;
+    int64_t count_plants() const;
 
-    int zero_offset = 0;
-    std::string state;
+    int64_t origin = 0;                 // pot number of bit 0 of words[0]
+    std::vector<uint64_t> words;
+    std::vector<uint64_t> next_year;
+    std::array<uint8_t,4096> lut;
     std::vector<Growth_condition> conditions;
+    // Pots are packed 64 to a word, pot 'origin + i' in bit i. The rules are
+    // folded into a table from a 12 pot window to the 8 pots at its centre,
+    // so a word of the next generation takes 8 lookups and some shifts. The
+    // rules are assumed to keep an empty neighbourhood empty ('..... => .').
 };
 
-void Plant_plan::prep_state()
+Plant_plan::Plant_plan(std::string init, std::vector<Growth_condition> vcond)
+    : conditions{std::move(vcond)}
 {
-    const int dist_const = 4;
+    auto rules = make_rule_table(conditions);
+    for (int w = 0; w < 4096; ++w) {
+        uint8_t out = 0;
+        for (int t = 0; t < 8; ++t)
+            if (rules[(w >> t) & 31])
+                out |= 1 << t;
+        lut[w] = out;
+    }
 
-    auto it = std::find(std::begin(state), std::end(state), '#');
-    int dist = std::distance(std::begin(state), it);
-    if (dist < dist_const) {
-        state.insert(0, dist_const - dist, '.');
-        zero_offset += dist_const - dist;
-    } else {
-        state.erase(0, dist - dist_const);
-        zero_offset -= dist - dist_const;
+    words.assign((init.size() + 63) / 64, 0);
+    for (size_t i = 0; i < init.size(); ++i)
+        if (init[i] == '#')
+            words[i / 64] |= uint64_t{1} << (i % 64);
+    prep_state();
+}
+
+void Plant_plan::prep_state()
+    // keep exactly one empty word at each end, plenty for 2 pots of growth
+{
+    size_t lead = 0;
+    while (lead < words.size() && words[lead] == 0)
+        ++lead;
+    if (lead == words.size()) {
+        words.assign(2, 0);
+        return;
     }
 
-    auto rit = std::find(std::rbegin(state), std::rend(state), '#');
-    if ((dist = std::distance(std::rbegin(state), rit)) < dist_const) {
-        state.append(dist_const - dist, '.');
+    if (lead == 0) {
+        words.insert(std::begin(words), 0);
+        origin -= 64;
+    } else if (lead > 1) {
+        words.erase(std::begin(words), std::begin(words) + lead - 1);
+        origin += 64 * int64_t(lead - 1);
     }
+
+    while (words.back() == 0 && words[words.size() - 2] == 0)
+        words.pop_back();
+    if (words.back() != 0)
+        words.push_back(0);
 }
 
 void Plant_plan::advance_year()
 {
-    prep_state();
-
-    std::string next_year(state.size(), '.');
-    for (size_t i = 0; i < state.size() - 5; ++i) {
+    next_year.assign(words.size(), 0);
+
+    const size_t n = words.size();
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t prev = i > 0 ? words[i-1] : 0;
+        uint64_t cur = words[i];
+        uint64_t nxt = i + 1 < n ? words[i+1] : 0;
+        if ((prev | cur | nxt) == 0)
+            continue;
+
+        uint64_t out = lut[((cur << 2) | (prev >> 62)) & 0xfff];
+        for (int k = 1; k < 7; ++k)
+            out |= uint64_t{lut[(cur >> (8 * k - 2)) & 0xfff]} << (8 * k);
+        out |= uint64_t{lut[((cur >> 54) | (nxt << 10)) & 0xfff]} << 56;
+        next_year[i] = out;
+    }
 
-        auto cit = std::find_if(std::begin(conditions), std::end(conditions),
-                [this, i](const auto& cnd) {
-                    return cnd.pattern == this->state.substr(i, 5);
-                });
+    words.swap(next_year);
+    prep_state();
+}
 
-        if (cit->result)
-            next_year[i + 2] = '#';
+int64_t Plant_plan::advance_year(int64_t n)
+    // Every generation is shifted so its first plant sits at bit 0 and the
+    // packed words become an exact key. Seeing a key again means the row
+    // repeats with some period and drifts by a fixed number of pots per
+    // period, so whole periods are skipped and only the remainder is run.
+    // Rows that have not repeated after history_limit generations are handed
+    // to Hash_life for the rest of the run.
+{
+    const int64_t history_limit = 2000;
+
+    struct Seen {
+        int64_t year;
+        int64_t offset;
+    };
+    std::unordered_map<std::string,Seen> seen;
+
+    for (int64_t year = 0; year < n; ++year) {
+        if (year == history_limit) {
+            Hash_life hl {get_state(), conditions, origin};
+            hl.advance_year(n - year);
+            return hl.sum_plant_pots();
+        }
+
+        int64_t offset;
+        auto key = normalized(offset);
+
+        auto it = seen.find(key);
+        if (it != std::end(seen)) {
+            int64_t period = year - it->second.year;
+            int64_t drift = offset - it->second.offset;
+            int64_t cycles = (n - year) / period;
+            for (int64_t r = (n - year) % period; r > 0; --r)
+                advance_year();
+            return sum_plant_pots() + cycles * drift * count_plants();
+        }
+
+        seen.emplace(std::move(key), Seen{year, offset});
+        advance_year();
     }
-    state = next_year;
+
+    return sum_plant_pots();
 }
 
-int64_t Plant_plan::advance_year(int64_t n)
+std::string Plant_plan::normalized(int64_t& offset) const
 {
-    int64_t this_year, last_year, this_diff, last_diff = -1;
-    this_year = last_year = this_diff = 0;
+    size_t first = 0;
+    while (first < words.size() && words[first] == 0)
+        ++first;
+    if (first == words.size()) {
+        offset = 0;
+        return std::string{};
+    }
 
-    while (this_diff != last_diff && n--) {
-        advance_year();
-        last_year = this_year;
-        this_year = sum_plant_pots();
-        last_diff = this_diff;
-        this_diff = this_year - last_year;
+    int shift = lowest_bit(words[first]);
+    offset = origin + 64 * int64_t(first) + shift;
+
+    size_t last = words.size();
+    while (words[last - 1] == 0)
+        --last;
+
+    std::string key;
+    key.reserve((last - first) * sizeof(uint64_t));
+    for (size_t i = first; i < last; ++i) {
+        uint64_t w = words[i] >> shift;
+        if (shift && i + 1 < last)
+            w |= words[i+1] << (64 - shift);
+        if (w == 0 && i + 1 == last)
+            break;                                  // shifted out
+        key.append(reinterpret_cast<const char*>(&w), sizeof(w));
     }
+    return key;
+}
 
-    int64_t total = sum_plant_pots();
-    while (n-- > 0)
-        total += this_diff;
-    return total;
+int64_t Plant_plan::count_plants() const
+{
+    int64_t count = 0;
+    for (auto w : words)
+        for (; w != 0; w &= w - 1)
+            ++count;
+    return count;
 }
 
 int64_t Plant_plan::sum_plant_pots() const
-    // not sure how to use std::accumulate here. need 'i'.
 {
     int64_t total = 0;
-    for (size_t i = 0; i < state.size(); ++i)
-        if (state[i] == '#')
-            total += i - zero_offset;
+    for (size_t i = 0; i < words.size(); ++i)
+        for (uint64_t w = words[i]; w != 0; w &= w - 1)
+            total += origin + 64 * int64_t(i) + lowest_bit(w);
     return total;
 }
 
+std::string Plant_plan::get_state() const
+{
+    std::string state (words.size() * 64, '.');
+    for (size_t i = 0; i < state.size(); ++i)
+        if ((words[i / 64] >> (i % 64)) & 1)
+            state[i] = '#';
+    return state;
+}
+
 // * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * 
 
 auto parse_input(const std::vector<std::string>& input)
@@ -1,291 +1,242 @@
 #include <iostream>
 #include <vector>
 #include <algorithm>
-#include <sstream>
+#include <array>
+#include <cstdint>
 
 #include <get_input.hpp>
 
 // * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * 
 
 class Off_tracks {};            // cart off track error
-class Ghost_crash{};            // crash with missing cart error
-class Bad_orient{};             // somehow tried to make cart out of not a cart
 
 // * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * 
 
-enum class Turn { left, straight, right };
+// Directions are 2 bits clockwise from up, so turning is +/- 1 mod 4.
+enum Direction : uint8_t { up, right, down, left };
+enum Piece : uint8_t { none, straight, slash, backslash, cross };
+enum Turn : uint8_t { turn_left, turn_straight, turn_right };
 
-Turn operator++(Turn& t)
-{
-    t = (t == Turn::right) ? Turn::left : Turn(int(t) + 1);
-    return t;
-}
-
-// * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * 
-
-enum class Orientation { up = '^', right = '>', down = 'v', left = '<',
-                         crash = 'X' };
-
-Orientation operator++(Orientation& o)
-{
-    switch (o) {
-    case Orientation::up:
-        o = Orientation::right;
-        break;
-    case Orientation::right:
-        o = Orientation::down;
-        break;
-    case Orientation::down:
-        o = Orientation::left;
-        break;
-    case Orientation::left:
-        o = Orientation::up;
-        break;
-    case Orientation::crash:
-        break;      // don't change crash
-    }
-    return o;
-}
+const char dir_glyph[] = "^>v<";
 
-Orientation operator--(Orientation& o)
-{
-    switch (o) {
-    case Orientation::up:
-        o = Orientation::left;
-        break;
-    case Orientation::right:
-        o = Orientation::up;
-        break;
-    case Orientation::down:
-        o = Orientation::right;
-        break;
-    case Orientation::left:
-        o = Orientation::down;
-        break;
-    case Orientation::crash:
-        break;      // don't change crash
-    }
-    return o;
-}
-
-// * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * 
-
-class Cart {
-public:
-    Cart(int x, int y, Orientation o);
-
-    int x() const { return xx; }
-    int y() const { return yy; }
-    char look_ahead(std::vector<std::string>& trax) const;
-    Orientation facing() const { return ff; }
-    char get_curr() const { return current; }
-
-    char turn();
-    void advance(std::vector<std::string>& trax, char look_ahead);
-    void bend(char ahead);
-    void crash() { ff = Orientation::crash; }
-    char crash(std::vector<Cart>& carts);
-private:
-    int xx, yy;
-    Orientation ff;
-    char current = '\0';            // save track piece
-    Turn next_turn = Turn::left;
+struct Transition {
+    uint8_t dir;
+    uint8_t turn;
 };
 
-Cart::Cart(int x, int y, Orientation o) : xx{x}, yy{y}, ff{o}
+int transition_index(int dir, int piece, int turn)
 {
-    switch (ff) {
-    case Orientation::up:
-    case Orientation::down:
-        current = '|';
-        break;
-    case Orientation::left:
-    case Orientation::right:
-        current = '-';
-        break;
-    default:
-        throw Bad_orient{};
-    }
+    return dir | piece << 2 | turn << 5;
 }
 
-char Cart::look_ahead(std::vector<std::string>& trax) const
+std::array<Transition,128> make_transitions()
+    // (direction, piece, turn state) -> (direction, turn state) for every
+    // combination, so moving a cart never walks a switch
 {
-    char token = '\0';
-
-    switch (ff) {
-    case Orientation::up:       token = trax[yy-1][xx]; break;
-    case Orientation::right:    token = trax[yy][xx+1]; break;
-    case Orientation::down:     token = trax[yy+1][xx]; break;
-    case Orientation::left:     token = trax[yy][xx-1]; break;
-    case Orientation::crash:    token = '\0';           break;
-    default:                                            break; }
-
-    return token;
+    std::array<Transition,128> table {};
+    for (int d = 0; d < 4; ++d)
+        for (int t = 0; t < 3; ++t) {
+            auto set = [&table, d, t](Piece p, int dir, int turn) {
+                table[transition_index(d, p, t)] =
+                    Transition{uint8_t(dir & 3), uint8_t(turn)};
+            };
+            set(none, d, t);
+            set(straight, d, t);
+            set(slash, d ^ 1, t);                   // up <-> right, etc.
+            set(backslash, 3 - d, t);               // up <-> left, etc.
+            set(cross, t == turn_left  ? d + 3 :
+                       t == turn_right ? d + 1 : d, (t + 1) % 3);
+        }
+    return table;
 }
 
-char Cart::turn()
+Piece to_piece(char ch)
 {
-    char next_token = '\0';
+    switch (ch) {
+    case '-':
+    case '|':   return straight;
+    case '/':   return slash;
+    case '\\':  return backslash;
+    case '+':   return cross;
+    default:    return none; }
+}
 
-    switch (next_turn) {
-    case Turn::left:      next_token = char(--ff);  break;
-    case Turn::straight:  next_token = char(ff);    break;
-    case Turn::right:     next_token = char(++ff);  break;
-    default:                                        break; }
+// * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * 
 
-    ++next_turn;
-    return next_token;
-}
+struct Crash {
+    int tick;
+    int x, y;
+};
 
-void Cart::advance(std::vector<std::string>& trax, char look_ahead)
-{
-    trax[yy][xx] = current;                     // replace track token
-    current = look_ahead;
+struct Ignore_crashes {
+    void operator()(const Crash&) { }
+};
 
-    switch (ff) {                               // move
-    case Orientation::up:     --yy; break;
-    case Orientation::right:  ++xx; break;
-    case Orientation::down:   ++yy; break;
-    case Orientation::left:   --xx; break;
-    default:                        break; }
+class First_crash {                 // Part 1 observer
+public:
+    void operator()(const Crash& c)
+    {
+        if (!seen)
+            first = c;
+        seen = true;
+    }
 
-    trax[yy][xx] = static_cast<char>(ff);       // put self on track
-}
+    bool seen = false;
+    Crash first {0, 0, 0};
+};
 
-void Cart::bend(char ahead)
-{
-    switch (ff) {
-    case Orientation::up:       ahead == '/' ? ++ff : --ff;     break;
-    case Orientation::right:    ahead == '/' ? --ff : ++ff;     break;
-    case Orientation::down:     ahead == '/' ? ++ff : --ff;     break;
-    case Orientation::left:     ahead == '/' ? --ff : ++ff;     break;
-    default:                                                    break; }
-}
+// * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * 
 
-char Cart::crash(std::vector<Cart>& carts)
-{
-    ff = Orientation::crash;
+class Mine {
+public:
+    explicit Mine(const std::vector<std::string>& input);
 
-    auto it = std::find_if(std::begin(carts), std::end(carts),
-            [this](auto& cart) {
-                return cart.facing() != Orientation::crash &&
-                       cart.x() == this->x() &&
-                       cart.y() == this->y();
-            });
+    size_t carts_left() const { return order.size(); }
+    int front() const { return order.front(); }
+    char glyph(int id) const { return dir_glyph[dir[id]]; }
+    int x(int id) const { return pos[id] % width; }
+    int y(int id) const { return pos[id] / width; }
 
-    if (it == std::end(carts))
-        throw Ghost_crash{};
+    template<typename Observer>
+    bool advance_tick(Observer& on_crash);
+    bool advance_tick() { Ignore_crashes ic; return advance_tick(ic); }
 
-    it->crash();
-    return it->get_curr();
-}
+    template<typename Observer>
+    int run(Observer& on_crash);
+private:
+    void reorder();
+
+    int ticks = 0;
+    int width = 0;
+    std::array<int,4> delta;        // flat step for each direction
+    std::vector<Piece> track;       // static pieces, carts lifted off
+    std::vector<int> occupancy;     // cart id per cell, -1 when empty
+    std::vector<int> order;         // ids of running carts, reading order
+
+    std::vector<int> pos;           // carts, one column per field
+    std::vector<uint8_t> dir;
+    std::vector<uint8_t> turn;
+    std::vector<uint8_t> alive;
+};
 
-bool operator<(const Cart& a, const Cart& b)
+Mine::Mine(const std::vector<std::string>& input)
 {
-    return a.y() < b.y() ||
-           (a.y() == b.y() && a.x() < b.x());
+    for (const auto& line : input)
+        width = std::max(width, int(line.size()));
+    delta = {-width, 1, width, -1};
+
+    track.assign(input.size() * width, none);
+    occupancy.assign(track.size(), -1);
+
+    for (size_t y = 0; y < input.size(); ++y)
+        for (size_t x = 0; x < input[y].size(); ++x) {
+            int p = y * width + x;
+            char ch = input[y][x];
+            auto d = std::find(dir_glyph, dir_glyph + 4, ch) - dir_glyph;
+            if (d == 4) {
+                track[p] = to_piece(ch);
+                continue;
+            }
+
+            track[p] = straight;
+            occupancy[p] = pos.size();
+            order.push_back(pos.size());
+            pos.push_back(p);
+            dir.push_back(uint8_t(d));
+            turn.push_back(turn_left);
+            alive.push_back(1);
+        }
 }
 
-std::ostream& operator<<(std::ostream& os, const Cart& c)
+void Mine::reorder()
+    // Carts move one cell a tick so last tick's order is nearly sorted and
+    // an insertion sort only pays for the few carts that swapped places.
 {
-    return os << char(c.facing()) << ' ' << c.x() << ',' << c.y();
+    for (size_t i = 1; i < order.size(); ++i) {
+        int id = order[i];
+        size_t j = i;
+        for (; j > 0 && pos[id] < pos[order[j-1]]; --j)
+            order[j] = order[j-1];
+        order[j] = id;
+    }
 }
 
-// * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * 
-
-auto map_carts(const std::vector<std::string>& trax)
+template<typename Observer>
+bool Mine::advance_tick(Observer& on_crash)
+    // Observers are called as crashes happen; taking them as a template
+    // parameter lets an empty one compile away entirely.
 {
-    std::vector<Cart> carts;
-    const std::string cart_symbols {"^v<>"};
+    static const auto transitions = make_transitions();
+    bool any_crashes = false;
 
-    for (size_t i = 0; i < trax.size(); ++i)
-        for (size_t j = 0; j < trax[i].size(); ++j)
-            if (cart_symbols.find(trax[i][j]) != std::string::npos)
-                carts.emplace_back(Cart{int(j), int(i),
-                                        Orientation(trax[i][j])});
+    reorder();
 
-    return carts;
-}
+    for (auto id : order) {
+        if (!alive[id])
+            continue;
 
-bool advance_tick(std::vector<std::string>& trax, std::vector<Cart>& carts)
-{
-    bool any_crashes = false;
+        occupancy[pos[id]] = -1;
+        pos[id] += delta[dir[id]];
 
-    std::sort(std::begin(carts), std::end(carts));
-
-    for (auto& cart : carts) {
-
-        char look_ahead = cart.look_ahead(trax);
-
-        switch (look_ahead) {
-        case '-':
-        case '|':
-            cart.advance(trax, look_ahead);
-            break;
-        case '/':
-        case '\\':
-            cart.advance(trax, look_ahead);
-            cart.bend(look_ahead);
-            break;
-        case '+':
-            cart.advance(trax, look_ahead);
-            cart.turn();
-            break;
-        case '^':
-        case 'v':
-        case '<':
-        case '>':
-            cart.advance(trax, look_ahead);
-            trax[cart.y()][cart.x()] = cart.crash(carts);
+        int& cell = occupancy[pos[id]];
+        if (cell >= 0) {                        // both carts leave the map
+            alive[cell] = alive[id] = 0;
+            cell = -1;
             any_crashes = true;
-            break;
-        case '\0':
-            break;
-        default:
-            std::cerr << "Somehow got off the tracks with: "
-                      << cart << '\n';
+            on_crash(Crash{ticks, x(id), y(id)});
+            continue;
+        }
+        cell = id;
+
+        auto piece = track[pos[id]];
+        if (piece == none) {
+            std::cerr << "Somehow got off the tracks with: " << glyph(id)
+                      << ' ' << x(id) << ',' << y(id) << '\n';
             throw Off_tracks{};
-            break;
         }
+
+        auto t = transitions[transition_index(dir[id], piece, turn[id])];
+        dir[id] = t.dir;
+        turn[id] = t.turn;
     }
 
     if (any_crashes)
-        carts.erase(std::remove_if(std::begin(carts), std::end(carts),
-                [](auto& cart) {
-                    return cart.facing() == Orientation::crash;
-                }), std::end(carts));
+        order.erase(std::remove_if(std::begin(order), std::end(order),
+                [this](int id) { return !alive[id]; }),
+            std::end(order));
 
+    ++ticks;
     return any_crashes;
 }
 
-std::string find_crash(const std::vector<Cart>& carts)
+template<typename Observer>
+int Mine::run(Observer& on_crash)
+    // until at most one cart is left, returns the number of ticks taken
 {
-    auto it = std::find_if(std::begin(carts), std::end(carts),
-            [](const auto& cart) {
-                return cart.facing() == Orientation::crash;
-            });
-    std::stringstream ss;
-    ss << it->x() << ',' << it->y();
-    return ss.str();
+    while (carts_left() > 1)
+        advance_tick(on_crash);
+    return ticks;
 }
 
+// * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * 
+
 int main(int argc, char* argv[])
 {
     std::cout << "AoC 2018 Day 13 - Mine Cart Madness\n";
 
-    auto trax = utils::get_input_lines(argc, argv, "13");
-    auto cartz = map_carts(trax);
-    /*
-    while (!advance_tick(trax, cartz))
-        ;
-    auto part1 = find_crash(cartz);
-    std::cout << "Part 1: " << part1 << '\n';
-    */
-
-    while (cartz.size() > 1) {
-        //std::cout << "Number of carts: " << cartz.size() << '\n';
-        advance_tick(trax, cartz);
+    auto input = utils::get_input_lines(argc, argv, "13");
+    Mine mine {input};
+    First_crash fc;
+    mine.run(fc);                   // both parts in one simulation
+
+    if (fc.seen)
+        std::cout << "Part 1: " << fc.first.x << ',' << fc.first.y << '\n';
+
+    if (mine.carts_left() == 1) {
+        auto last = mine.front();
+        std::cout << "Part 2: " << mine.glyph(last) << ' ' << mine.x(last)
+                  << ',' << mine.y(last) << '\n';
+    } else {
+        std::cout << "Part 2: no carts left\n";
     }
-    auto part2 = cartz.front();
-    std::cout << "Part 2: " << part2 << '\n';
 }
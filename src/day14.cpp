@@ -1,89 +1,183 @@
 #include <iostream>
 #include <vector>
+#include <array>
 #include <algorithm>
-#include <sstream>
+#include <cstdint>
+#include <cmath>
 
 #include <get_input.hpp>
 
+class Seq_matcher {
+    // KMP automaton over the digits 0-9. Each recipe is fed in once and the
+    // state says how much of the sequence the latest recipes end with.
+private:
+    std::vector<std::array<int,10>> dfa;
+    int state = 0;
+public:
+    explicit Seq_matcher(const std::vector<uint8_t>& seq);
+
+    bool feed(uint8_t digit) { state = dfa[state][digit]; return matched(); }
+    bool matched() const { return state == int(dfa.size()) - 1; }
+    size_t size() const { return dfa.size() - 1; }
+};
+
+Seq_matcher::Seq_matcher(const std::vector<uint8_t>& seq)
+    : dfa(seq.size() + 1)
+{
+    if (seq.empty())
+        return;
+
+    dfa[0].fill(0);
+    dfa[0][seq[0]] = 1;
+
+    int fallback = 0;
+    for (size_t j = 1; j <= seq.size(); ++j) {
+        dfa[j] = dfa[fallback];
+        if (j == seq.size())
+            break;                          // full match falls back too
+        dfa[j][seq[j]] = j + 1;
+        fallback = dfa[fallback][seq[j]];
+    }
+}
+
+// * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * 
+
+struct New_recipes {
+    uint8_t first, second;          // second is scratch when count is 1
+    uint8_t count;
+};
+
+constexpr New_recipes digit_pairs[19] = {
+    {0,0,1}, {1,0,1}, {2,0,1}, {3,0,1}, {4,0,1}, {5,0,1}, {6,0,1}, {7,0,1},
+    {8,0,1}, {9,0,1}, {1,0,2}, {1,1,2}, {1,2,2}, {1,3,2}, {1,4,2}, {1,5,2},
+    {1,6,2}, {1,7,2}, {1,8,2},
+};
+
+// * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * 
+
 class Kitchen {
 private:
     size_t e1 = 0;
     size_t e2 = 1;
-    std::vector<int> recipes;
+    size_t n = 2;                           // recipes on the scoreboard
+    std::vector<uint8_t> recipes;           // one digit a byte, preallocated
 public:
-    Kitchen()
-        : recipes{std::vector<int>{3, 7}} { /* no reserve.. */ }
+    explicit Kitchen(size_t estimate = 0);
 
     long cook_n(int target);
     size_t cook_till_seq(const std::string& sequence);
 
 private:
-    void cook();
-    void assign_new_recipes();
+    void cook(size_t until);
 };
 
+Kitchen::Kitchen(size_t estimate)
+    : recipes(std::max<size_t>(estimate, 64) + 2, 0)
+{
+    recipes[0] = 3;
+    recipes[1] = 7;
+}
+
 long Kitchen::cook_n(int target)
 {
     size_t range = target + 10;
-    while (recipes.size() < range) {
-        cook();
-        assign_new_recipes();
-    }
+    cook(range);
 
-    std::stringstream ss;
+    long score = 0;
     for (size_t i = target; i < range; ++i)
-        ss << recipes[i];
-    return std::stol(ss.str());
+        score = score * 10 + recipes[i];
+    return score;
 }
 
 size_t Kitchen::cook_till_seq(const std::string& sequence)
+    // Stray characters such as the input's newline are not part of the
+    // sequence.
 {
-    std::vector<int> vseq(sequence.size());
-    std::transform(std::begin(sequence), std::end(sequence), std::begin(vseq),
-            [](auto ch) { return ch - '0'; });
+    std::vector<uint8_t> vseq;
+    for (auto ch : sequence)
+        if ('0' <= ch && ch <= '9')
+            vseq.push_back(ch - '0');
 
-    size_t dist = 0;
+    Seq_matcher matcher {vseq};
+    size_t scanned = 0;
+    const size_t chunk = 1 << 16;
 
     while (true) {
-        for (size_t i = 0; i < vseq.size(); ++i) {
-            cook();
-            assign_new_recipes();
-        }
+        for (; scanned < n; ++scanned)
+            if (matcher.feed(recipes[scanned]))
+                return scanned + 1 - matcher.size();
 
-        auto irec = std::begin(recipes);
-        std::advance(irec, dist);
-
-        auto it = std::search(irec, std::end(recipes),
-                              std::begin(vseq), std::end(vseq));
-        if (it != std::end(recipes))
-            return std::distance(std::begin(recipes), it);
-        else
-            dist = recipes.size() + 1 - vseq.size();
+        cook(n + chunk);
     }
 }
 
-void Kitchen::cook()
+void Kitchen::cook(size_t until)
+    // Cooks until there are at least 'until' recipes. An elf moves at most
+    // 10 places a step, so while both are more than 10 * k places from the
+    // end of the board the next k steps cannot wrap. Those run as a batch
+    // with no wrap checks; the few steps near the end subtract instead.
+    // New digits come from the pair table and both bytes are always
+    // written, which leaves no branch on the size of the sum.
 {
-    auto result = recipes[e1] + recipes[e2];
-    if (result > 9)
-        recipes.push_back(1);
-    recipes.push_back(result % 10);
-}
+    if (recipes.size() < until + 2)                 // estimate was short
+        recipes.resize(std::max(recipes.size() * 2, until + 2));
+    uint8_t* r = recipes.data();
+
+    while (n < until) {
+        size_t safe = (n - 1 - std::max(e1, e2)) / 10;
+        size_t steps = std::min(safe, (until - n + 1) / 2);
+
+        if (steps == 0) {
+            const auto& nr = digit_pairs[r[e1] + r[e2]];
+            r[n] = nr.first;
+            r[n+1] = nr.second;
+            n += nr.count;
+
+            e1 += 1 + r[e1];
+            while (e1 >= n)
+                e1 -= n;
+            e2 += 1 + r[e2];
+            while (e2 >= n)
+                e2 -= n;
+            continue;
+        }
 
-inline void Kitchen::assign_new_recipes()
-{
-    e1 = (e1 + 1 + recipes[e1]) % recipes.size();
-    e2 = (e2 + 1 + recipes[e2]) % recipes.size();
+        size_t nn = n, a = e1, b = e2;
+        for (size_t i = 0; i < steps; ++i) {
+            uint8_t ra = r[a], rb = r[b];
+            const auto& nr = digit_pairs[ra + rb];
+            r[nn] = nr.first;
+            r[nn+1] = nr.second;
+            nn += nr.count;
+            a += 1 + ra;
+            b += 1 + rb;
+        }
+        n = nn;
+        e1 = a;
+        e2 = b;
+    }
 }
 
 // * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * 
 
+size_t estimate_recipes(const std::string& sequence)
+    // A random run of k digits first shows up around 10^k recipes in, so
+    // leave some room over that without reserving absurd amounts up front.
+{
+    const size_t cap = size_t{1} << 28;
+    auto k = std::count_if(std::begin(sequence), std::end(sequence),
+            [](auto ch) { return '0' <= ch && ch <= '9'; });
+    double guess = 4 * std::pow(10.0, double(k));
+    return guess < cap ? size_t(guess) : cap;
+}
+
 int main(int argc, char* argv[])
 {
     std::cout << "AoC 2018 Day 14 - Chocolate Charts\n";
 
     auto input = utils::get_input_string(argc, argv, "14");
-    auto k = Kitchen{};
+    auto k = Kitchen{std::max<size_t>(std::stoi(input) + 11,
+                                      estimate_recipes(input))};
 
     auto part1 = k.cook_n(std::stoi(input));
     std::cout << "Part 1: " << part1 << '\n';
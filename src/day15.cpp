@@ -1,40 +1,24 @@
 #include <iostream>
 #include <vector>
 #include <algorithm>
-#include <numeric>
 #include <limits>
 #include <memory>
+#include <array>
+#include <thread>
+#include <cstdint>
 
 #include <get_input.hpp>
 
 const int int_max = std::numeric_limits<int>::max();
 
+class No_winning_power{};   // errors for throwing
+
 // * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * 
 
 struct Point {
     int x, y;
-
-    std::vector<Point> get_adjacents() const;
-
-    bool is_adjacent(const Point& pt) const { return distance(pt) == 1; }
-    int distance(const Point& pt) const
-        { return std::abs(x - pt.x) + std::abs(y - pt.y); }
-
-    void move_to(const Point& pt) { x = pt.x; y = pt.y; }
 };
 
-std::vector<Point> Point::get_adjacents() const
-{
-    std::vector<Point> vpoints;
-
-    vpoints.emplace_back(Point{x, y-1});    // up
-    vpoints.emplace_back(Point{x-1, y});    // left
-    vpoints.emplace_back(Point{x+1, y});    // right
-    vpoints.emplace_back(Point{x, y+1});    // down
-
-    return vpoints;
-}
-
 bool operator==(const Point& a, const Point& b)
 {
     return a.x == b.x && a.y == b.y;
@@ -59,362 +43,386 @@ std::ostream& operator<<(std::ostream& os, const Point& pt)
 
 class Dist_map {
 private:
-    std::vector<std::vector<int>> dist_map;
+    int width;
+    const std::vector<char>* grid = nullptr;    // last map measured
+    std::vector<int> dist_map;
+    std::vector<unsigned> stamp;            // dist_map[i] valid if == gen
+    unsigned gen = 0;
+    std::vector<int> queue;                 // ring buffer of cell indexes
+    // The buffers live as long as the battle. Starting a new map just bumps
+    // 'gen', so nothing is refilled between turns; cells the search never
+    // reached fall back to the battle map.
 public:
-    Dist_map(const std::vector<std::string>& battle_map);
+    Dist_map(int w, int h)
+        : width{w}, dist_map(w * h), stamp(w * h, 0), queue(w * h) { }
 
     void print_grid() const;
-    void map_distances(const Point& pt);
-    Point find_1(const Point& pt) const;
 
-    int operator()(const Point& p) const { return dist_map[p.y][p.x]; }
+    template<typename Pred>
+    int nearest(const std::vector<char>& battle_map, int origin, Pred is_goal);
+
+    int operator()(const Point& p) const
+    {
+        int i = index(p);
+        if (stamp[i] == gen)
+            return dist_map[i];
+        return (*grid)[i] == '.' ? int_max : -1;
+    }
 private:
-    void map_adjacents(const Point& pt, int n);
+    int index(const Point& p) const { return (p.y + 1) * width + p.x + 1; }
 };
 
-Dist_map::Dist_map(const std::vector<std::string>& battle_map)
-{
-    dist_map.resize(battle_map.size());
-
-    for (auto& vi : dist_map)
-        vi.resize(battle_map.front().size());
-
-    for (size_t i = 0; i < battle_map.size(); ++i)
-        for (size_t j = 0; j < battle_map[i].size(); ++j)
-            dist_map[i][j] = battle_map[i][j] == '.' ? int_max : -1;
-}
-
 void Dist_map::print_grid() const
 {
-    for (const auto& row : dist_map) {
-        for (const auto i : row)
-            std::cout << i << '\t';
+    int height = dist_map.size() / width;
+    for (int y = 0; y < height - 2; ++y) {
+        for (int x = 0; x < width - 2; ++x)
+            std::cout << (*this)(Point{x, y}) << '\t';
         std::cout << '\n';
     }
 }
 
-void Dist_map::map_distances(const Point& pt)
-{
-    dist_map[pt.y][pt.x] = 0;
-
-    map_adjacents(pt, 1);
-}
-
-Point Dist_map::find_1(const Point& pt) const
-{
-    int dist = (*this)(pt);
-    if (dist == 1)
-        return pt;
-
-    auto vadj = pt.get_adjacents();         // returns points in reading order
-    auto it = std::find_if(std::begin(vadj), std::end(vadj),
-            [this, dist](const auto& pt) {
-                return (*this)(pt) == dist - 1;
-            });
-
-    return find_1(*it);
-}
-
-void Dist_map::map_adjacents(const Point& pt, int n)
+template<typename Pred>
+int Dist_map::nearest(const std::vector<char>& battle_map, int origin,
+                      Pred is_goal)
+    // Level order from origin: every open cell is queued once, when it is
+    // first reached, and that first visit is already its shortest distance.
+    // The search stops after the first level holding a goal and returns the
+    // goal first in reading order, or -1 when none is reachable. The map's
+    // border is padded with walls so no bounds checks are needed.
 {
-    auto adjacents = pt.get_adjacents();
-
-    std::vector<std::pair<bool,Point>> bool_adjs;
-    for (const auto adj : adjacents)
-        bool_adjs.emplace_back(std::make_pair(false, std::move(adj)));
-
-    for (auto& adj : bool_adjs) {
-        int x = adj.second.x;
-        int y = adj.second.y;
-        if (0 <= x && x < int(dist_map.front().size()) && 0 <= y && 
-                y < int(dist_map.size())) { // check if valid point
-            int* pi = &dist_map[y][x];      // get current distance value
-            if (0 < *pi && n < *pi) {       // if 'open' and greater than n..
-                *pi = n;                    // ..set value to n..
-                adj.first = true;           // and mark it to be mapped
+    if (++gen == 0) {                       // stamps wrapped, start over
+        std::fill(std::begin(stamp), std::end(stamp), 0);
+        gen = 1;
+    }
+    grid = &battle_map;
+
+    dist_map[origin] = 0;
+    stamp[origin] = gen;
+    if (is_goal(origin))
+        return origin;
+
+    const int steps[] = { -width, -1, 1, width };
+    const size_t cap = queue.size();
+    size_t head = 0, tail = 0, queued = 0;
+
+    queue[tail] = origin;
+    tail = (tail + 1) % cap;
+    ++queued;
+
+    int found = -1;
+    while (queued) {
+        int cell = queue[head];
+        int n = dist_map[cell] + 1;
+        if (found >= 0 && n > dist_map[found])
+            break;                          // goal level fully explored
+        head = (head + 1) % cap;
+        --queued;
+
+        for (auto step : steps) {
+            int adj = cell + step;
+            if (stamp[adj] != gen && battle_map[adj] == '.') {
+                dist_map[adj] = n;
+                stamp[adj] = gen;
+                queue[tail] = adj;
+                tail = (tail + 1) % cap;
+                ++queued;
+
+                if (is_goal(adj) && (found < 0 || adj < found))
+                    found = adj;
             }
         }
     }
 
-    for (auto& adj : bool_adjs)
-        if (adj.first)
-            map_adjacents(adj.second, n + 1);
+    return found;
 }
 
 // * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * 
 
-class Unit;
-
 class Battle {
 private:
     int rounds = 0;
-    std::vector<std::string> battle_map;
-    std::vector<Unit> units;
+    int width, height;                      // including the padding
+    std::vector<char> battle_map;           // row major, walled border
+    std::array<int,4> steps;                // up, left, right, down
+
+    // the unit table, one column per attribute, indexed by unit id
+    std::vector<int> pos;                   // battle_map index
+    std::vector<int> hp;                    // alive while > 0
+    std::vector<int> atk;
+    std::vector<char> faction;              // 'E' or 'G'
+    std::vector<int> occupant;              // battle_map index -> unit id
+    std::vector<int> order;                 // live units, turn order
+    int elves = 0, goblins = 0;             // live counts
+
+    Dist_map dist_map;
+    std::vector<unsigned> in_range;         // squares next to a target
+    unsigned in_range_gen = 0;
+    bool stop_on_elf_loss = false;          // part 2 trials give up early
+    bool elf_lost = false;
 public:
     explicit Battle(const std::vector<std::string>& input, int elf_dam = 3);
 
     void print_grid() const;
     int get_score() const;
-    Dist_map get_dist_map(const Point& origin) const;
-
-    bool run_simulation();
-    std::vector<Unit*> get_targets(const char type);
 
-    void write_move(const Point& from, const Point& to, const char token);
-    void write_out(const Point& pt) { battle_map[pt.y][pt.x] = '.'; }
+    bool run_simulation(bool stop_on_elf_loss = false);
 private:
+    int index(const Point& p) const { return (p.y + 1) * width + p.x + 1; }
+    bool is_alive(int u) const { return hp[u] > 0; }
+    int enemies_of(int u) const { return faction[u] == 'E' ? goblins : elves; }
+
     bool process_turn();
+    bool take_turn(int u);
+    int weakest_adjacent(int u) const;
+    int plan_move(int u);
+    void move(int u, int to);
+    void attack(int u, int target);
 };
 
 // * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * 
 
-class Unit {
-private:
-    char token;
-    Point location;
-    int hp = 200;
-    Battle* pb;
-    int atk_pwr;
-public:
-    Unit(char tt, int xx, int yy, Battle* pbattle, int pwr = 3)
-        : token{tt}, location{xx, yy}, pb{pbattle}, atk_pwr{pwr} { }
-
-    Point get_loc()  const { return location; }
-    char  get_tok()  const { return token; }
-    int   get_hp()   const { return hp; }
-    bool  is_alive() const { return hp > 0 ? true : false; }
-
-    bool take_turn();
-    void move(const std::vector<Unit*>& vu, const Dist_map& dm);
-    void attack(Unit& u) const;
-    void take_damage(int damage);
-private:
-    std::vector<Unit*>::iterator check_adj(std::vector<Unit*>& targets) const;
-    Point get_target_square(const std::vector<Unit*>& tars,
-                            const Dist_map& dmap) const;
-    Unit* get_weakest_adjacent(std::vector<Unit*>& tars) const;
-};
+Battle::Battle(const std::vector<std::string>& input, int elf_dam)
+    : width{int(input.front().size()) + 2}, height{int(input.size()) + 2},
+      battle_map(width * height, '#'), steps{{ -width, -1, 1, width }},
+      occupant(width * height, -1), dist_map{width, height},
+      in_range(width * height, 0)
+{
+    for (size_t y = 0; y < input.size(); ++y)
+        for (size_t x = 0; x < input[y].size(); ++x) {
+            int i = index(Point{int(x), int(y)});
+            char c = input[y][x];
+            battle_map[i] = c;
+            if (c != 'E' && c != 'G')
+                continue;                   // nothing to add for #'s and .'s
+
+            occupant[i] = pos.size();
+            order.push_back(pos.size());
+            pos.push_back(i);
+            hp.push_back(200);
+            atk.push_back(c == 'E' ? elf_dam : 3);
+            faction.push_back(c);
+            ++(c == 'E' ? elves : goblins);
+        }
+}
 
-std::ostream& operator<<(std::ostream& os, const Unit& u)
+void Battle::print_grid() const
 {
-    return os << u.get_tok() << '@' << u.get_loc()
-              << '(' << u.get_hp() << ')';
+    for (int y = 1; y < height - 1; ++y) {
+        for (int x = 1; x < width - 1; ++x)
+            std::cout << battle_map[y * width + x];
+        std::cout << '\n';
+    }
+    std::cout << '\n';
 }
 
-void Unit::attack(Unit& u) const
+int Battle::get_score() const
 {
-    u.take_damage(atk_pwr);
+    int sum = 0;
+    for (size_t u = 0; u < hp.size(); ++u)
+        if (is_alive(u))
+            sum += hp[u];
+
+    return rounds * sum;
 }
 
-bool Unit::take_turn()
+bool Battle::run_simulation(bool stop_on_loss)
+    // returns true if every elf survived; with stop_on_loss the battle is
+    // abandoned at the first elf death, leaving the score meaningless
 {
-    auto targets = pb->get_targets(token);
-    if (targets.empty())
-        return false;                               // end of battle!
-
-    auto it_adj = check_adj(targets);               // attack if already adj
-    if (it_adj != std::end(targets)) {
-        auto weakest = get_weakest_adjacent(targets);
-        attack(*weakest);
-    }
-    else {
-        auto dist_map = pb->get_dist_map(get_loc());
-        move(targets, dist_map);
+    stop_on_elf_loss = stop_on_loss;
 
-        it_adj = check_adj(targets);
-        if (it_adj != std::end(targets)) {
-            auto weakest = get_weakest_adjacent(targets);
-            attack(*weakest);
-        }
+    while (process_turn()) {
+        ++rounds;
     }
 
-    return true;
+    return !elf_lost;
 }
 
-Unit* Unit::get_weakest_adjacent(std::vector<Unit*>& vptars) const
+bool Battle::process_turn()
+    // units that died last round drop out of the turn order before the one
+    // sort by position; those killed mid round are skipped when reached
 {
-    std::vector<Unit*> vpadj;
-    std::copy_if(std::begin(vptars), std::end(vptars),
-                 std::back_inserter(vpadj), [this](const auto ptar) {
-                     return this->get_loc().is_adjacent(ptar->get_loc());
-                 });
-
-    std::sort(std::begin(vpadj), std::end(vpadj),
-            [](const auto& pa, const auto& pb) {
-                return pa->get_hp() < pb->get_hp();
-            });
+    order.erase(std::remove_if(std::begin(order), std::end(order),
+                [this](int u) { return !is_alive(u); }),
+            std::end(order));
+    std::sort(std::begin(order), std::end(order),
+            [this](int a, int b) { return pos[a] < pos[b]; });
+
+    for (auto u : order)
+        if (is_alive(u) && !take_turn(u))   // false take_turn ends battle
+            return false;
+        else if (stop_on_elf_loss && elf_lost)
+            return false;
 
-    return vpadj.front();
+    return true;
 }
 
-void Unit::move(const std::vector<Unit*>& vu, const Dist_map& dmap)
+bool Battle::take_turn(int u)
 {
-    Point temp = location;
-    auto goal = get_target_square(vu, dmap);
+    if (enemies_of(u) == 0)
+        return false;                       // end of battle!
 
-    if (goal == Point{0,0})
-        return;
-
-    goal = dmap.find_1(goal);
-    location.move_to(goal);
+    int target = weakest_adjacent(u);       // attack if already adj
+    if (target < 0) {
+        move(u, plan_move(u));
+        target = weakest_adjacent(u);
+    }
+    if (target >= 0)
+        attack(u, target);
 
-    pb->write_move(temp, get_loc(), get_tok());
+    return true;
 }
 
-std::vector<Unit*>::iterator Unit::check_adj(std::vector<Unit*>& targets) const
+int Battle::weakest_adjacent(int u) const
+    // the steps run in reading order so the first weakest wins ties
 {
-    std::sort(std::begin(targets), std::end(targets),
-            [](const auto pa, const auto pb) {
-                return pa->get_loc() < pb->get_loc();
-            });
+    int weakest = -1;
+    for (auto step : steps) {
+        int v = occupant[pos[u] + step];
+        if (v >= 0 && faction[v] != faction[u] &&
+                (weakest < 0 || hp[v] < hp[weakest]))
+            weakest = v;
+    }
 
-    return std::find_if(std::begin(targets), std::end(targets),
-            [this](const auto p) {
-                return this->get_loc().is_adjacent(p->get_loc());
-            });
+    return weakest;
 }
 
-Point Unit::get_target_square(const std::vector<Unit*>& vptargets,
-                              const Dist_map& dmap) const
+int Battle::plan_move(int u)
+    // One search out from the unit finds the closest square in range of a
+    // target (reading order on ties), then one search back from that square
+    // finds which of the unit's neighbours starts a shortest path to it.
+    // Returns the unit's own square when no square in range can be reached.
 {
-    std::vector<Point> all_pts;
-    for (const auto ptarget : vptargets) {
-        auto vtemp = ptarget->get_loc().get_adjacents();
-        std::copy(std::begin(vtemp), std::end(vtemp),
-                  std::back_inserter(all_pts));
+    if (++in_range_gen == 0) {
+        std::fill(std::begin(in_range), std::end(in_range), 0);
+        in_range_gen = 1;
     }
 
-    all_pts.erase(std::remove_if(std::begin(all_pts), std::end(all_pts),
-                [&dmap](const auto& pt) {
-                    return dmap(pt) < 0 || dmap(pt) == int_max;
-                }), std::end(all_pts));
-
-    if (all_pts.empty())
-        return Point{0,0};                  // good use case for std::optional
-
-    auto sm_it = std::min_element(std::begin(all_pts), std::end(all_pts),
-            [&dmap](const auto& a, const auto& b) {
-                return dmap(a) < dmap(b);
+    for (auto v : order)
+        if (is_alive(v) && faction[v] != faction[u])
+            for (auto step : steps)
+                in_range[pos[v] + step] = in_range_gen;
+
+    int start = pos[u];
+    int goal = dist_map.nearest(battle_map, start,
+            [this](int i) { return in_range[i] == in_range_gen; });
+    if (goal < 0)
+        return start;
+
+    return dist_map.nearest(battle_map, goal,
+            [this, start](int i) {
+                return i == start - width || i == start - 1 ||
+                       i == start + 1 || i == start + width;
             });
-
-    int smallest = dmap(*sm_it);
-    all_pts.erase(std::remove_if(std::begin(all_pts), std::end(all_pts),
-                [&dmap, smallest](const auto& pt) {
-                    return smallest < dmap(pt);
-                }), std::end(all_pts));
-
-    std::sort(std::begin(all_pts), std::end(all_pts));
-    
-    return all_pts.front();
 }
 
-void Unit::take_damage(int damage)
+void Battle::move(int u, int to)
 {
-    hp -= damage;
-    if (hp <= 0)
-        pb->write_out(get_loc());
-}
+    int from = pos[u];
+    if (from == to)
+        return;
 
-bool operator<(const Unit& a, const Unit& b)
-{
-    return a.get_loc() < b.get_loc();
+    battle_map[from] = '.';
+    occupant[from] = -1;
+    battle_map[to] = faction[u];
+    occupant[to] = u;
+    pos[u] = to;
 }
 
-// * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * 
-
-Battle::Battle(const std::vector<std::string>& input, int elf_dam)
-    : battle_map{input}
+void Battle::attack(int u, int target)
 {
-    for (size_t y = 0; y < battle_map.size(); ++y)
-        for (size_t x = 0; x < battle_map[y].size(); ++x) {
-            switch (battle_map[y][x]) {
-            case 'E':
-                units.emplace_back(Unit{'E', int(x), int(y), this, elf_dam});
-                break;
-            case 'G':
-                units.emplace_back(Unit{'G', int(x), int(y), this});
-                break;
-            default:
-                // do nothing for #'s and .'s
-                break;
-            }
-        }
-}
+    hp[target] -= atk[u];
+    if (is_alive(target))
+        return;
 
-void Battle::print_grid() const
-{
-    for (const auto& row : battle_map) {
-        for (const auto ch : row)
-            std::cout << ch;
-        std::cout << '\n';
+    battle_map[pos[target]] = '.';
+    occupant[pos[target]] = -1;
+    if (faction[target] == 'E') {
+        --elves;
+        elf_lost = true;
     }
-    std::cout << '\n';
-}
-
-int Battle::get_score() const
-{
-    return rounds * std::accumulate(std::begin(units), std::end(units), 0,
-                [](auto sum, auto& u) { return sum + u.get_hp(); });
-}
-
-bool Battle::run_simulation()
-{
-    const auto num_elves = std::count_if(std::begin(units), std::end(units),
-            [](const auto& u) { return u.get_tok() == 'E'; });
-
-    while (process_turn()) {
-        ++rounds;
+    else {
+        --goblins;
     }
-
-    // remove deceased units
-    units.erase(std::remove_if(std::begin(units), std::end(units),
-                [](auto& u) { return !u.is_alive(); }),
-            std::end(units));
-
-    // part 2: check on elves..
-    auto cur_elves = std::count_if(std::begin(units), std::end(units),
-            [](const auto& u) { return u.get_tok() == 'E' && u.is_alive(); });
-
-    if (cur_elves == num_elves)
-        return true;
-    return false;
-}
-
-void Battle::write_move(const Point& from, const Point& to, const char token)
-{
-    battle_map[from.y][from.x] = '.';
-    battle_map[to.y][to.x] = token;
 }
 
-Dist_map Battle::get_dist_map(const Point& origin) const
-{
-    auto dist_map = Dist_map{battle_map};
+// * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * 
 
-    dist_map.map_distances(origin);
+struct Trial {
+    int power;
+    bool elves_won;                         // no elf died
+    int score;
+};
 
-    return dist_map;
+Trial run_trial(const std::vector<std::string>& input, int power)
+{
+    auto battle = std::make_unique<Battle>(input, power);
+    bool won = battle->run_simulation(true);
+    return Trial{power, won, won ? battle->get_score() : 0};
 }
 
-std::vector<Unit*> Battle::get_targets(const char type)
+std::vector<Trial> run_trials(const std::vector<std::string>& input,
+                              const std::vector<int>& powers)
+    // one thread per power, each building its own battle
 {
-    std::vector<Unit*> targets;
+    std::vector<Trial> trials (powers.size());
+    std::vector<std::thread> vt;
+    for (size_t i = 0; i < powers.size(); ++i)
+        vt.emplace_back([&input, &powers, &trials, i]() {
+                trials[i] = run_trial(input, powers[i]);
+            });
 
-    for (auto& unit : units)
-        if (unit.get_tok() != type && unit.is_alive())
-            targets.push_back(&unit);
+    for (auto& t : vt)
+        t.join();
 
-    return targets;
+    return trials;
 }
 
-bool Battle::process_turn()
+Trial find_min_power(const std::vector<std::string>& input, int lost)
+    // Smallest elf power above 'lost' where no elf dies. Winning is assumed
+    // monotone in power, so each batch of trials narrows (lost, won]: first
+    // galloping up with doubling steps until some power wins, then splitting
+    // the bracket evenly among the threads until it closes. With a single
+    // thread this is plain galloping and binary search. Powers past
+    // max_power kill in one hit like max_power does, so the gallop stops there.
 {
-    std::sort(std::begin(units), std::end(units));
+    const int max_power = 200;              // a unit's full hit points
+    const int width = std::max(1u, std::thread::hardware_concurrency());
+    Trial won {0, false, 0};
+
+    auto narrow = [&](const std::vector<int>& powers) {
+        for (const auto& t : run_trials(input, powers)) {
+            if (t.elves_won) {
+                won = t;
+                break;
+            }
+            lost = t.power;
+        }
+    };
+
+    for (int step = 1; !won.elves_won; ) {
+        if (lost >= max_power)
+            throw No_winning_power{};
+
+        std::vector<int> powers;
+        for (int i = 0; i < width && lost + step < max_power; ++i, step *= 2)
+            powers.push_back(lost + step);
+        if (int(powers.size()) < width)
+            powers.push_back(max_power);
+        narrow(powers);
+    }
 
-    for (auto& unit : units)
-        if (unit.is_alive() && !unit.take_turn())   // false take_turn ends
-            return false;                           // battle
+    while (won.power - lost > 1) {
+        int gap = won.power - lost;
+        int n = std::min(width, gap - 1);
+        std::vector<int> powers;
+        for (int i = 1; i <= n; ++i)
+            powers.push_back(lost + int(std::int64_t{gap} * i / (n + 1)));
+        narrow(powers);
+    }
 
-    return true;
+    return won;
 }
 
 // * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * 
@@ -432,11 +440,6 @@ int main(int argc, char* argv[])
     auto part1 = battle->get_score();
     std::cout << "Part 1: " << part1 << '\n';
 
-    do {
-        auto temp = std::make_unique<Battle>(input, ++elf_pwr);
-        battle = std::move(temp);
-    } while(!(battle->run_simulation()));
-
-    auto part2 = battle->get_score();
+    auto part2 = find_min_power(input, elf_pwr).score;
     std::cout << "Part 2: " << part2 << '\n';
 }
@@ -1,16 +1,18 @@
 #include <iostream>
 #include <vector>
 #include <array>
-#include <unordered_map>
 #include <algorithm>
-#include <functional>
 #include <sstream>
+#include <thread>
+#include <random>
+#include <chrono>
+#include <cstdint>
 
 #include <get_input.hpp>
+#include <elfcode.hpp>
 
 using Registers = std::array<int,4>;
 using Instruction = std::array<int,4>;
-using Execution = std::function<Registers(const Instruction&,Registers)>;
 
 struct Sample_op {
 public:
@@ -72,154 +74,247 @@ auto parse_input(std::istringstream& iss)
     return vso;
 }
 
+const int n_opcodes = utils::n_elf_ops;
+using Device = utils::Elf_machine<int,4>;
+
+// Candidate opcodes are kept as bit sets, one bit per opcode, so a whole row
+// of the code x opcode matrix is a single word.
+using Op_set = std::uint64_t;
+using Op_matrix = std::array<Op_set,n_opcodes>;
+static_assert(n_opcodes <= 64, "an Op_set holds at most 64 opcodes");
+
+const Op_set all_ops = n_opcodes == 64 ? ~Op_set{0}
+                                       : (Op_set{1} << n_opcodes) - 1;
+
+class No_mapping{};     // errors for throwing
+class Bad_opcode{};
+
+Op_set match_mask(const Sample_op& s)
+    // bit n set if opcode n turns 'before' into 'after'; an op can only match
+    // when every register other than C is unchanged, so that is checked once
+{
+    const int c = s.ins[3];
+    if (c < 0 || c >= int(Registers{}.size()))
+        return 0;                           // no op can write there
+    for (int i = 0; i < 4; ++i)
+        if (i != c && s.before[i] != s.after[i])
+            return 0;
+
+    auto in_range = [](int v, utils::Elf_operand kind) {
+        return kind != utils::reg || (v >= 0 && v < int(Registers{}.size()));
+    };
+
+    Op_set mask = 0;
+    for (int op = 0; op < n_opcodes; ++op) {
+        const auto& kinds = utils::elf_operands[op];
+        if (in_range(s.ins[1], kinds[0]) && in_range(s.ins[2], kinds[1]))
+            mask |= Op_set(utils::evaluate(utils::Elf_op(op), s.ins[1],
+                                           s.ins[2], s.before) == s.after[c])
+                    << op;
+    }
+
+    return mask;
+}
+
+int popcount(Op_set mask)
+{
+    int n = 0;
+    for ( ; mask; mask &= mask - 1)
+        ++n;
+    return n;
+}
+
+int lowest_op(Op_set mask)
+{
+    int op = 0;
+    for ( ; !(mask & 1); mask >>= 1)
+        ++op;
+    return op;
+}
+
+template<typename Iter>
+Op_matrix reduce_samples(Iter first, Iter last)
+    // a code keeps an opcode only while every one of its samples matches it
+{
+    Op_matrix m;
+    m.fill(all_ops);
+    for ( ; first != last; ++first)
+        m[first->ins[0]] &= match_mask(*first);
+
+    return m;
+}
+
+Op_matrix candidate_matrix(const std::vector<Sample_op>& vso)
+    // The samples are split in contiguous chunks, each thread AND-reduces its
+    // own chunk into a private matrix, and the matrices are ANDed at the end.
+    // Small sample sets stay on the calling thread.
+{
+    if (std::any_of(std::begin(vso), std::end(vso), [](const auto& so) {
+                return so.ins[0] < 0 || so.ins[0] >= n_opcodes;
+            }))
+        throw Bad_opcode{};
+
+    const size_t min_chunk = 1 << 14;
+    size_t num_threads = std::thread::hardware_concurrency();
+    num_threads = std::max<size_t>(1,
+            std::min(num_threads, vso.size() / min_chunk));
+    if (num_threads == 1)
+        return reduce_samples(std::begin(vso), std::end(vso));
+
+    const size_t chunk = (vso.size() + num_threads - 1) / num_threads;
+    std::vector<Op_matrix> partial (num_threads);
+    std::vector<std::thread> vt;
+    for (size_t i = 0; i < num_threads; ++i)
+        vt.emplace_back([&vso, &partial, chunk, i]() {
+                auto first = std::begin(vso) + std::min(i * chunk, vso.size());
+                auto last = std::begin(vso) +
+                            std::min((i + 1) * chunk, vso.size());
+                partial[i] = reduce_samples(first, last);
+            });
+
+    for (auto& t : vt)
+        t.join();
+
+    Op_matrix m;
+    m.fill(all_ops);
+    for (const auto& p : partial)
+        for (int code = 0; code < n_opcodes; ++code)
+            m[code] &= p[code];
+
+    return m;
+}
+
 class Operations {
 private:
-    std::unordered_map<std::string,Execution> ops;
-    std::unordered_map<std::string,std::vector<int>> op_tally;
-    std::unordered_map<int,std::string> op_map;
+    Op_matrix candidates;                               // code -> opcodes
+    std::array<utils::Elf_op,n_opcodes> op_map;         // code -> opcode
 public:
-    Operations();
-
     int count_possible(const Sample_op& s) const;
     void map_ops(const std::vector<Sample_op>& vso);
     void print_op_tally() const;
-    void execute(const Instruction& ins, Registers& r) const;
+    utils::Elf_instruction decode(const Instruction& ins) const;
+    utils::Elf_program decode(std::istream& is) const;
 private:
-    void reduce_op_tally(int key);
+    bool augment(int code, std::array<int,n_opcodes>& owner,
+                 Op_set& seen, Op_set taken) const;
 };
 
-Operations::Operations()
-{
-    ops.emplace("addr", [](const Instruction& ins, Registers r) {
-                r[ins[3]]  = r[ins[1]] + r[ins[2]];
-                return r;
-            });
-    ops.emplace("addi", [](const Instruction& ins, Registers r) {
-                r[ins[3]]  = r[ins[1]] + ins[2];
-                return r;
-            });
-    ops.emplace("mulr", [](const Instruction& ins, Registers r) {
-                r[ins[3]]  = r[ins[1]] * r[ins[2]];
-                return r;
-            });
-    ops.emplace("muli", [](const Instruction& ins, Registers r) {
-                r[ins[3]]  = r[ins[1]] * ins[2];
-                return r;
-            });
-    ops.emplace("banr", [](const Instruction& ins, Registers r) {
-                r[ins[3]]  = r[ins[1]] & r[ins[2]];
-                return r;
-            });
-    ops.emplace("bani", [](const Instruction& ins, Registers r) {
-                r[ins[3]]  = r[ins[1]] & ins[2];
-                return r;
-            });
-    ops.emplace("borr", [](const Instruction& ins, Registers r) {
-                r[ins[3]]  = r[ins[1]] | r[ins[2]];
-                return r;
-            });
-    ops.emplace("bori", [](const Instruction& ins, Registers r) {
-                r[ins[3]]  = r[ins[1]] | ins[2];
-                return r;
-            });
-    ops.emplace("setr", [](const Instruction& ins, Registers r) {
-                r[ins[3]]  = r[ins[1]];
-                return r;
-            });
-    ops.emplace("seti", [](const Instruction& ins, Registers r) {
-                r[ins[3]]  = ins[1];
-                return r;
-            });
-    ops.emplace("gtir", [](const Instruction& ins, Registers r) {
-                r[ins[3]] = ins[1] > r[ins[2]] ? 1 : 0;
-                return r;
-            });
-    ops.emplace("gtri", [](const Instruction& ins, Registers r) {
-                r[ins[3]] = r[ins[1]] > ins[2] ? 1 : 0;
-                return r;
-            });
-    ops.emplace("gtrr", [](const Instruction& ins, Registers r) {
-                r[ins[3]] = r[ins[1]] > r[ins[2]] ? 1 : 0;
-                return r;
-            });
-    ops.emplace("eqir", [](const Instruction& ins, Registers r) {
-                r[ins[3]] = ins[1] == r[ins[2]] ? 1 : 0;
-                return r;
-            });
-    ops.emplace("eqri", [](const Instruction& ins, Registers r) {
-                r[ins[3]] = r[ins[1]] == ins[2] ? 1 : 0;
-                return r;
-            });
-    ops.emplace("eqrr", [](const Instruction& ins, Registers r) {
-                r[ins[3]] = r[ins[1]] == r[ins[2]] ? 1 : 0;
-                return r;
-            });
-}
-
 int Operations::count_possible(const Sample_op& s) const
 {
-    auto t = std::count_if(std::begin(ops), std::end(ops),
-            [&s](const auto& op) {
-                auto after = op.second(s.ins, s.before);
-                return after == s.after;
-            });
-
-    return t;
+    return popcount(match_mask(s));
 }
 
 void Operations::map_ops(const std::vector<Sample_op>& vso)
+    // Propagates singletons until nothing changes: a code with one opcode
+    // left takes it, and an opcode left to a single code goes to that code.
+    // Whatever propagation cannot settle is finished by bipartite matching.
+    // Throws No_mapping if the samples admit no complete assignment.
 {
-    for (const auto& op : ops) {
-        std::vector<int> codes;
-        for (const auto& so : vso) {
-            auto code = so.ins[0];
-            auto it = std::find(std::begin(codes), std::end(codes), code);
-
-            if (op.second(so.ins, so.before) == so.after) {
-                if (it == std::end(codes))
-                    codes.push_back(code);
-            } else {
-                if (it != std::end(codes))
-                    codes.erase(it);
+    candidates = candidate_matrix(vso);
+
+    std::array<int,n_opcodes> assigned;                 // code -> opcode
+    assigned.fill(-1);
+    Op_set taken = 0;
+
+    for (bool progress = true; progress; ) {
+        progress = false;
+        for (int code = 0; code < n_opcodes; ++code) {
+            if (assigned[code] >= 0)
+                continue;
+            Op_set left = candidates[code] & ~taken;
+            if (!left)
+                throw No_mapping{};
+            if (!(left & (left - 1))) {
+                assigned[code] = lowest_op(left);
+                taken |= left;
+                progress = true;
             }
         }
-        op_tally[op.first] = std::move(codes);
-    }
 
-    auto key = std::find_if(std::begin(op_tally), std::end(op_tally),
-            [](auto& op) { return op.second.size() == 1; })->second.front();
+        for (int op = 0; op < n_opcodes; ++op) {
+            const Op_set bit = Op_set{1} << op;
+            if (taken & bit)
+                continue;
+            int only = -1, count = 0;
+            for (int code = 0; code < n_opcodes; ++code)
+                if (assigned[code] < 0 && (candidates[code] & bit)) {
+                    only = code;
+                    ++count;
+                }
+            if (count == 0)
+                throw No_mapping{};
+            if (count == 1) {
+                assigned[only] = op;
+                taken |= bit;
+                progress = true;
+            }
+        }
+    }
 
-    reduce_op_tally(key);
+    std::array<int,n_opcodes> owner;                    // opcode -> code
+    owner.fill(-1);
+    for (int code = 0; code < n_opcodes; ++code) {
+        if (assigned[code] >= 0)
+            continue;
+        Op_set seen = 0;
+        if (!augment(code, owner, seen, taken))
+            throw No_mapping{};
+    }
+    for (int op = 0; op < n_opcodes; ++op)
+        if (owner[op] >= 0)
+            assigned[owner[op]] = op;
 
-    for (const auto& op : op_tally)
-        op_map[op.second.front()] = op.first;
+    for (int code = 0; code < n_opcodes; ++code)
+        op_map[code] = utils::Elf_op(assigned[code]);
 }
 
-void Operations::reduce_op_tally(int key)
+bool Operations::augment(int code, std::array<int,n_opcodes>& owner,
+                         Op_set& seen, Op_set taken) const
+    // Kuhn's augmenting path search over the opcodes propagation left open
 {
-    for (auto& op : op_tally) {
-        auto it = std::find(std::begin(op.second), std::end(op.second), key);
-        if (op.second.size() > 1 && it != std::end(op.second)) {
-            op.second.erase(it);
-            if (op.second.size() == 1)
-                reduce_op_tally(op.second.front());
+    for (Op_set left = candidates[code] & ~taken & ~seen; left;
+            left &= left - 1) {
+        int op = lowest_op(left);
+        Op_set bit = Op_set{1} << op;
+        if (seen & bit)
+            continue;
+        seen |= bit;
+        if (owner[op] < 0 || augment(owner[op], owner, seen, taken)) {
+            owner[op] = code;
+            return true;
         }
     }
+
+    return false;
 }
 
 void Operations::print_op_tally() const
 {
-    for (const auto& op : op_tally) {
-        std::cout << op.first << '\t';
-        for (const auto& i : op.second)
-            std::cout << i << ' ';
+    for (int op = 0; op < n_opcodes; ++op) {
+        std::cout << utils::elf_op_names[op] << '\t';
+        for (int code = 0; code < n_opcodes; ++code)
+            if (candidates[code] & (Op_set{1} << op))
+                std::cout << code << ' ';
         std::cout << '\n';
     }
 }
 
-void Operations::execute(const Instruction& ins, Registers& r) const
+utils::Elf_instruction Operations::decode(const Instruction& ins) const
+    // resolves the code to its opcode once, ahead of execution
+{
+    if (ins[0] < 0 || ins[0] >= n_opcodes)
+        throw Bad_opcode{};
+
+    return utils::make_instruction(op_map[ins[0]], ins[1], ins[2], ins[3]);
+}
+
+utils::Elf_program Operations::decode(std::istream& is) const
 {
-    r = ops.at(op_map.at(ins[0]))(ins, r);
+    utils::Elf_program prog;
+    for (Instruction ins; is >> ins[0] >> ins[1] >> ins[2] >> ins[3]; )
+        utils::push_instruction(prog, decode(ins));
+
+    return prog;
 }
 
 // * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * 
@@ -236,15 +331,37 @@ int get_part_one(const Operations& ops, const std::vector<Sample_op>& vso)
 
 int run_test_program(std::istream& is, const Operations& ops)
 {
-    Registers r { 0, 0, 0, 0 };
-    std::string line;
-    while (is) {
-        Instruction ins;
-        for (auto& v : ins)
-            is >> v;
-        ops.execute(ins, r);
-    }
-    return r[0];
+    Device device;
+    device.run(ops.decode(is));
+    return device[0];
+}
+
+void run_benchmark(const Operations& ops, size_t length, int reps)
+    // runs a random straight line program of 'length' instructions 'reps'
+    // times over, with operands kept in register range for every opcode
+{
+    std::mt19937 gen {16};
+    std::uniform_int_distribution<int> code {0, n_opcodes - 1};
+    std::uniform_int_distribution<int> reg {0, 3};
+
+    utils::Elf_program prog;
+    prog.code.reserve(length);
+    for (size_t i = 0; i < length; ++i)
+        utils::push_instruction(prog, ops.decode(
+                    Instruction{ code(gen), reg(gen), reg(gen), reg(gen) }));
+
+    Device device;
+    device.registers() = Registers{ 1, 2, 3, 4 };
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < reps; ++i)
+        device.run(prog);
+    std::chrono::duration<double> secs = std::chrono::steady_clock::now()
+                                         - start;
+
+    size_t total = length * reps;
+    std::cout << "Instructions: " << total << " in " << secs.count() << "s ("
+              << (secs.count() > 0 ? total / secs.count() : 0)
+              << " instructions/s), r0 = " << device[0] << '\n';
 }
 
 // * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * 
@@ -253,6 +370,14 @@ int main(int argc, char* argv[])
 {
     std::cout << "AoC 2018 Day 16 Chronal Classification\n";
 
+    // benchmark mode: day16 -b [-t | file] maps the ops from the samples and
+    // times a large generated program
+    bool bench = argc > 1 && std::string{argv[1]} == "-b";
+    if (bench) {
+        --argc;
+        ++argv;
+    }
+
     auto input = utils::get_input_string(argc, argv, "16");
 
     std::istringstream iss {input};
@@ -260,6 +385,11 @@ int main(int argc, char* argv[])
     Operations ops {};
     ops.map_ops(vso);
 
+    if (bench) {
+        run_benchmark(ops, 1 << 20, 100);
+        return 0;
+    }
+
     auto part1 = get_part_one(ops, vso);
     std::cout << "Part 1: " << part1 << '\n';
     auto part2 = run_test_program(iss, ops);